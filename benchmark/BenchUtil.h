@@ -0,0 +1,231 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Helpers shared by the benchmark programs: command line options, a
+ * monotonic clock, /proc sampling and a minimal JSON writer. Header only,
+ * the benchmarks are not part of the library.
+ */
+
+// Logger output for the benchmarks, stdout is kept for the JSON results
+inline void logToStderr(const char *msg, size_t len)
+{
+    ::fwrite(msg, 1, len, stderr);
+}
+
+inline uint64_t nowNs()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * --name=value or --name value; a bare --flag is "1". Every option must be
+ * declared with a default through get(), unknown ones are reported by
+ * checkUnknown() so a typo doesn't silently benchmark the default.
+ */
+class Options
+{
+public:
+    Options(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg.compare(0, 2, "--") != 0)
+            {
+                fprintf(stderr, "unexpected argument %s\n", arg.c_str());
+                ::exit(2);
+            }
+            arg = arg.substr(2);
+            size_t eq = arg.find('=');
+            if (eq != std::string::npos)
+            {
+                values_[arg.substr(0, eq)] = arg.substr(eq + 1);
+            }
+            else if (i + 1 < argc && ::strncmp(argv[i + 1], "--", 2) != 0)
+            {
+                values_[arg] = argv[++i];
+            }
+            else
+            {
+                values_[arg] = "1";
+            }
+        }
+    }
+
+    std::string get(const std::string &name, const std::string &defaultValue, const char *help)
+    {
+        usage_ += "  --" + name + " (" + defaultValue + ")  " + help + "\n";
+        known_[name] = true;
+        std::map<std::string, std::string>::const_iterator it = values_.find(name);
+        return it == values_.end() ? defaultValue : it->second;
+    }
+    long getInt(const std::string &name, long defaultValue, const char *help)
+    {
+        return ::strtol(get(name, std::to_string(defaultValue), help).c_str(), nullptr, 10);
+    }
+    double getDouble(const std::string &name, double defaultValue, const char *help)
+    {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%g", defaultValue);
+        return ::strtod(get(name, buf, help).c_str(), nullptr);
+    }
+
+    // exits with the usage text on --help or an undeclared option
+    void checkUnknown(const char *program) const
+    {
+        bool bad = values_.count("help") > 0;
+        for (std::map<std::string, std::string>::const_iterator it = values_.begin(); it != values_.end(); ++it)
+        {
+            if (!known_.count(it->first) && it->first != "help")
+            {
+                fprintf(stderr, "unknown option --%s\n", it->first.c_str());
+                bad = true;
+            }
+        }
+        if (bad)
+        {
+            fprintf(stderr, "usage: %s [options]\n%s", program, usage_.c_str());
+            ::exit(2);
+        }
+    }
+
+private:
+    std::map<std::string, std::string> values_;
+    std::map<std::string, bool> known_;
+    std::string usage_;
+};
+
+// CPU time and resident memory of a process, from /proc
+struct ProcStats
+{
+    ProcStats() : cpuSeconds(0), rssKb(0) {}
+
+    double cpuSeconds; // user + system
+    long rssKb;
+};
+
+inline bool readProcStats(int pid, ProcStats *stats)
+{
+    char path[64];
+    snprintf(path, sizeof path, "/proc/%d/stat", pid);
+    FILE *fp = ::fopen(path, "r");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    char buf[1024];
+    size_t n = ::fread(buf, 1, sizeof buf - 1, fp);
+    ::fclose(fp);
+    buf[n] = '\0';
+    // fields after the parenthesized command name, which may contain spaces
+    const char *p = ::strrchr(buf, ')');
+    unsigned long utime = 0, stime = 0;
+    long rssPages = 0;
+    if (p == nullptr ||
+        ::sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d %*d %*d %*d %*d %*u %*u %ld",
+                 &utime, &stime, &rssPages) != 3)
+    {
+        return false;
+    }
+    stats->cpuSeconds = static_cast<double>(utime + stime) / ::sysconf(_SC_CLK_TCK);
+    stats->rssKb = rssPages * (::sysconf(_SC_PAGESIZE) / 1024);
+    return true;
+}
+
+/**
+ * Builds one JSON object. Nested objects are opened with beginObject(key)
+ * and closed with endObject(); keys are written as given.
+ */
+class JsonWriter
+{
+public:
+    JsonWriter() : first_(true) { out_ = "{"; }
+
+    JsonWriter &add(const char *key, const std::string &value)
+    {
+        this->key(key);
+        out_ += '"';
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            char c = value[i];
+            if (c == '"' || c == '\\')
+            {
+                out_ += '\\';
+            }
+            out_ += c;
+        }
+        out_ += '"';
+        return *this;
+    }
+    JsonWriter &add(const char *key, const char *value) { return add(key, std::string(value)); }
+    JsonWriter &add(const char *key, double value)
+    {
+        char buf[64];
+        snprintf(buf, sizeof buf, "%.6g", value);
+        this->key(key);
+        out_ += buf;
+        return *this;
+    }
+    JsonWriter &add(const char *key, uint64_t value)
+    {
+        this->key(key);
+        out_ += std::to_string(value);
+        return *this;
+    }
+    JsonWriter &add(const char *key, long value)
+    {
+        this->key(key);
+        out_ += std::to_string(value);
+        return *this;
+    }
+    JsonWriter &add(const char *key, int value) { return add(key, static_cast<long>(value)); }
+    JsonWriter &add(const char *key, bool value)
+    {
+        this->key(key);
+        out_ += value ? "true" : "false";
+        return *this;
+    }
+
+    JsonWriter &beginObject(const char *key)
+    {
+        this->key(key);
+        out_ += '{';
+        first_ = true;
+        return *this;
+    }
+    JsonWriter &endObject()
+    {
+        out_ += '}';
+        first_ = false;
+        return *this;
+    }
+
+    std::string str() const { return out_ + "}"; }
+
+private:
+    void key(const char *k)
+    {
+        if (!first_)
+        {
+            out_ += ',';
+        }
+        first_ = false;
+        out_ += '"';
+        out_ += k;
+        out_ += "\":";
+    }
+
+    std::string out_;
+    bool first_;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+
+#include "BenchUtil.h"
+
+/**
+ * HDR-style histogram: values below 128 are counted exactly, above that
+ * every power of two is split into 64 linear sub-buckets, so a reported
+ * percentile is within 1/64 (1.6%) of the true value over the whole
+ * uint64_t range, in 3776 counters. Not thread safe, keep one per thread and
+ * merge() them.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram()
+        : counts_(kNumBuckets, 0),
+          total_(0),
+          sum_(0),
+          min_(UINT64_MAX),
+          max_(0)
+    {
+    }
+
+    void record(uint64_t value)
+    {
+        ++counts_[bucketOf(value)];
+        ++total_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (int i = 0; i < kNumBuckets; ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        sum_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? static_cast<double>(sum_) / total_ : 0; }
+
+    // highest value equivalent to the q-th quantile (0 < q <= 1), capped at max()
+    uint64_t percentile(double q) const
+    {
+        if (total_ == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(q * total_ + 0.5);
+        rank = std::max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for (int i = 0; i < kNumBuckets; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+            {
+                return std::min(highestOf(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    // p50/p90/p99/p99.9/max/mean, scaled by 1/divisor (e.g. 1000 for ns -> us)
+    void toJson(JsonWriter *json, const char *key, double divisor) const
+    {
+        json->beginObject(key)
+            .add("count", count())
+            .add("min", min() / divisor)
+            .add("mean", mean() / divisor)
+            .add("p50", percentile(0.5) / divisor)
+            .add("p90", percentile(0.9) / divisor)
+            .add("p99", percentile(0.99) / divisor)
+            .add("p999", percentile(0.999) / divisor)
+            .add("max", max() / divisor)
+            .endObject();
+    }
+
+private:
+    static const int kSubBits = 6;
+    static const int kLinear = 2 << kSubBits; // 128 exact values
+    static const int kNumBuckets = kLinear + (63 - kSubBits) * (1 << kSubBits);
+
+    static int bucketOf(uint64_t value)
+    {
+        if (value < static_cast<uint64_t>(kLinear))
+        {
+            return static_cast<int>(value);
+        }
+        int msb = 63 - __builtin_clzll(value); // >= kSubBits + 1
+        int shift = msb - kSubBits;
+        int sub = static_cast<int>(value >> shift) - (1 << kSubBits);
+        return kLinear + (msb - kSubBits - 1) * (1 << kSubBits) + sub;
+    }
+
+    static uint64_t highestOf(int bucket)
+    {
+        if (bucket < kLinear)
+        {
+            return static_cast<uint64_t>(bucket);
+        }
+        int index = bucket - kLinear;
+        int msb = index / (1 << kSubBits) + kSubBits + 1;
+        uint64_t sub = static_cast<uint64_t>(index % (1 << kSubBits) + (1 << kSubBits));
+        int shift = msb - kSubBits;
+        return (sub << shift) + ((1ull << shift) - 1);
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+};
@@ -0,0 +1,280 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "EventLoop.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpServer.h"
+#include "Logger.h"
+#include "TcpServer.h"
+
+/**
+ * Server side of the network benchmarks, see loadgen.cc for the client.
+ *
+ *   echo     sends every byte back
+ *   discard  drops what it reads
+ *   http     HttpServer answering every request with --body-size bytes
+ *   file     answers every byte it reads with --file-size bytes of a
+ *            temporary file, through sendFile() or, with --sendfile 0,
+ *            pread() + send()
+ *
+ * Runs until SIGINT/SIGTERM or --duration, then prints one JSON object with
+ * its CPU time, peak RSS and the summed loop metrics.
+ */
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void onSignal(int)
+{
+    g_stop = 1;
+}
+
+struct ServerConfig
+{
+    std::string mode;
+    long zeroCopyThreshold;
+    long bodySize;
+    long fileSize;
+    bool useSendFile;
+    int fileFd;
+};
+
+static void onEchoMessage(const ServerConfig *config, const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    if (config->zeroCopyThreshold > 0 && buf->readableBytes() >= static_cast<size_t>(config->zeroCopyThreshold))
+    {
+        std::shared_ptr<const std::string> message(new std::string(buf->retrieveAllAsString()));
+        conn->sendZeroCopy(message);
+    }
+    else
+    {
+        conn->send(buf);
+    }
+}
+
+static void onDiscardMessage(const TcpConnectionPtr &, Buffer *buf, Timestamp)
+{
+    buf->retrieveAll();
+}
+
+static void onFileMessage(const ServerConfig *config, const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    static thread_local std::vector<char> data;
+    size_t requests = buf->readableBytes();
+    buf->retrieveAll();
+    for (size_t i = 0; i < requests; ++i)
+    {
+        if (config->useSendFile)
+        {
+            conn->sendFile(config->fileFd, 0, config->fileSize);
+        }
+        else
+        {
+            data.resize(config->fileSize);
+            ssize_t n = ::pread(config->fileFd, data.data(), data.size(), 0);
+            if (n > 0)
+            {
+                conn->send(data.data(), n);
+            }
+        }
+    }
+}
+
+static void onHttpRequest(const ServerConfig *config, const HttpRequest &, HttpResponse *resp)
+{
+    static thread_local std::string body;
+    body.assign(config->bodySize, 'x');
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setContentType("text/plain");
+    resp->setBody(body);
+}
+
+static int createDataFile(long size)
+{
+    char path[] = "/tmp/benchserver.XXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd < 0)
+    {
+        LOG_FATAL("benchserver: mkstemp failed errno:%d\n", errno);
+    }
+    ::unlink(path);
+    std::vector<char> block(64 * 1024, 'f');
+    for (long written = 0; written < size;)
+    {
+        size_t n = static_cast<size_t>(size - written) < block.size() ? size - written : block.size();
+        written += ::write(fd, block.data(), n);
+    }
+    return fd;
+}
+
+static void printSummary(const ServerConfig &config, TcpServer &server, int threads)
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                 usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    LoopMetrics::Snapshot metrics = server.metrics();
+    double gb = (metrics.bytesRead + metrics.bytesWritten) / 1e9;
+
+    JsonWriter json;
+    json.add("program", "benchserver")
+        .add("mode", config.mode)
+        .add("threads", threads)
+        .add("cpu_s", cpu)
+        .add("cpu_s_per_gb", gb > 0 ? cpu / gb : 0.0)
+        .add("max_rss_kb", static_cast<long>(usage.ru_maxrss))
+        .add("bytes_read", metrics.bytesRead)
+        .add("bytes_written", metrics.bytesWritten)
+        .add("connections_opened", metrics.connectionsOpened)
+        .add("connections_closed", metrics.connectionsClosed)
+        .add("iterations", metrics.iterations)
+        .add("functors_run", metrics.functorsRun)
+        .add("poll_wait_p50_us", LoopMetrics::Snapshot::percentile(metrics.pollWaitUs, 0.5))
+        .add("poll_wait_p99_us", LoopMetrics::Snapshot::percentile(metrics.pollWaitUs, 0.99))
+        .add("processing_p99_us", LoopMetrics::Snapshot::percentile(metrics.processingUs, 0.99));
+    printf("%s\n", json.str().c_str());
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    Options options(argc, argv);
+    ServerConfig config;
+    int port = options.getInt("port", 9981, "listen port");
+    int threads = options.getInt("threads", 1, "IO threads, 0 serves from the accepting loop");
+    config.mode = options.get("mode", "echo", "echo|discard|http|file");
+    std::string accept = options.get("accept", "single", "single|reuseport|shared: one acceptor, or one per IO loop");
+    std::string dispatch = options.get("dispatch", "rr", "rr|least|p2c|hash, with --accept single");
+    int acceptBatch = options.getInt("accept-batch", Acceptor::kDefaultMaxAcceptsPerRead, "connections accepted per readable event");
+    bool edgeTriggered = options.getInt("edge-triggered", 0, "register connections edge-triggered");
+    int busyPoll = options.getInt("busy-poll", 0, "spin this many microseconds after activity");
+    int socketBusyPoll = options.getInt("socket-busy-poll", 0, "SO_BUSY_POLL microseconds");
+    config.zeroCopyThreshold = options.getInt("zerocopy", 0, "echo messages of at least this many bytes with MSG_ZEROCOPY");
+    std::string poller = options.get("poller", "epoll", "epoll|io_uring");
+    bool pin = options.getInt("pin", 0, "pin IO loops to CPUs");
+    config.bodySize = options.getInt("body-size", 13, "http: response body bytes");
+    config.fileSize = options.getInt("file-size", 1 << 20, "file: bytes sent per request");
+    config.useSendFile = options.getInt("sendfile", 1, "file: sendfile() instead of pread() + send()");
+    double duration = options.getDouble("duration", 0, "seconds to run, 0 runs until SIGINT");
+    int logLevel = options.getInt("log-level", ERROR, "0 DEBUG .. 3 FATAL");
+    options.checkUnknown(argv[0]);
+
+    Logger::setLogLevel(logLevel);
+    Logger::setOutput(logToStderr);
+    if (poller == "io_uring")
+    {
+        ::setenv("MUDUO_USE_IO_URING", "1", 1);
+    }
+    ::signal(SIGPIPE, SIG_IGN);
+    ::signal(SIGINT, onSignal);
+    ::signal(SIGTERM, onSignal);
+    config.fileFd = config.mode == "file" ? createDataFile(config.fileSize) : -1;
+
+    TcpServer::Option option = TcpServer::kNoReusePort;
+    if (accept == "reuseport")
+    {
+        option = TcpServer::kReusePortPerLoop;
+    }
+    else if (accept == "shared")
+    {
+        option = TcpServer::kSharedListenFd;
+    }
+
+    EventLoop loop;
+    InetAddress addr(port);
+    std::unique_ptr<HttpServer> httpServer;
+    std::unique_ptr<TcpServer> tcpServer;
+    TcpServer *server = nullptr;
+    if (config.mode == "http")
+    {
+        httpServer.reset(new HttpServer(&loop, addr, "benchserver", option));
+        httpServer->setHttpCallback(std::bind(&onHttpRequest, &config, std::placeholders::_1, std::placeholders::_2));
+        server = &httpServer->server();
+    }
+    else
+    {
+        tcpServer.reset(new TcpServer(&loop, addr, "benchserver", option));
+        server = tcpServer.get();
+        if (config.mode == "echo")
+        {
+            server->setMessageCallback(std::bind(&onEchoMessage, &config, std::placeholders::_1,
+                                                 std::placeholders::_2, std::placeholders::_3));
+        }
+        else if (config.mode == "discard")
+        {
+            server->setMessageCallback(&onDiscardMessage);
+        }
+        else if (config.mode == "file")
+        {
+            server->setMessageCallback(std::bind(&onFileMessage, &config, std::placeholders::_1,
+                                                 std::placeholders::_2, std::placeholders::_3));
+        }
+        else
+        {
+            fprintf(stderr, "unknown --mode %s\n", config.mode.c_str());
+            return 2;
+        }
+        if (config.zeroCopyThreshold > 0)
+        {
+            long threshold = config.zeroCopyThreshold;
+            server->setConnectionCallback([threshold](const TcpConnectionPtr &conn)
+                                          {
+                                              if (conn->connected())
+                                              {
+                                                  conn->setZeroCopyThreshold(threshold);
+                                              }
+                                          });
+        }
+    }
+
+    server->setThreadNum(threads);
+    server->setMaxAcceptsPerRead(acceptBatch);
+    server->setEdgeTriggered(edgeTriggered);
+    server->setBusyPoll(busyPoll, socketBusyPoll);
+    server->threadPool()->setAutoCpuAffinity(pin);
+    if (dispatch == "least")
+    {
+        server->setDispatchPolicy(EventLoopThreadPool::kLeastConnections);
+    }
+    else if (dispatch == "p2c")
+    {
+        server->setDispatchPolicy(EventLoopThreadPool::kPowerOfTwoChoices);
+    }
+    else if (dispatch == "hash")
+    {
+        server->setDispatchPolicy(EventLoopThreadPool::kPeerHash);
+    }
+
+    if (httpServer)
+    {
+        httpServer->start();
+    }
+    else
+    {
+        server->start();
+    }
+    fprintf(stderr, "benchserver: %s on port %d, %d threads, pid %d\n",
+            config.mode.c_str(), port, threads, static_cast<int>(::getpid()));
+
+    Timestamp deadline = addTime(Timestamp::now(), duration);
+    loop.runEvery(0.1, [&]()
+                  {
+                      if (g_stop || (duration > 0 && deadline < Timestamp::now()))
+                      {
+                          printSummary(config, *server, threads);
+                          loop.quit();
+                      }
+                  });
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,609 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "LatencyHistogram.h"
+#include "Buffer.h"
+#include "ConnectionPool.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "Logger.h"
+#include "TcpClient.h"
+#include "TcpConnection.h"
+
+/**
+ * Load generator for benchserver, built on the library's own TcpClient.
+ * Connections are spread over --threads loops and every loop keeps its own
+ * counters and histograms, merged once at the end; nothing is shared on the
+ * hot path.
+ *
+ *   pingpong  every connection bounces one --size message off an echo
+ *             server as fast as it can: throughput
+ *   latency   request/response over persistent connections, --pipeline
+ *             requests in flight each; --protocol http sends GETs;
+ *             --pool 1 borrows a connection from a ConnectionPool per
+ *             request instead of owning one
+ *   churn     connect, one request/response, close, repeat: connects/sec
+ *             and connect latency
+ *   idle      open --connections and hold them; with --server-pid the
+ *             server's resident memory per connection
+ *
+ * Prints one JSON object. With --server-pid the server's CPU time over the
+ * measured interval is included, read from /proc.
+ */
+
+struct Config
+{
+    std::string scenario;
+    std::string protocol;
+    std::string path;
+    std::string host;
+    size_t size;
+    size_t responseSize;
+    int pipeline;
+    bool pool;
+};
+
+static Config g_config;
+static InetAddress *g_serverAddr = nullptr;
+static std::atomic_int g_established(0);
+
+// one per loop thread, touched only by that thread
+struct Worker
+{
+    explicit Worker(EventLoop *loopArg)
+        : loop(loopArg),
+          measuring(false),
+          running(true),
+          requests(0),
+          bytes(0),
+          connects(0),
+          errors(0)
+    {
+    }
+
+    void reset()
+    {
+        latency.reset();
+        connectLatency.reset();
+        requests = 0;
+        bytes = 0;
+        connects = 0;
+        errors = 0;
+    }
+
+    EventLoop *loop;
+    bool measuring;
+    bool running;
+    LatencyHistogram latency;        // ns
+    LatencyHistogram connectLatency; // ns
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t connects;
+    uint64_t errors;
+    std::unique_ptr<ConnectionPool> pool;
+};
+
+static std::string makeRequest()
+{
+    if (g_config.protocol == "http")
+    {
+        return "GET " + g_config.path + " HTTP/1.1\r\nHost: " + g_config.host + "\r\n\r\n";
+    }
+    return std::string(g_config.size, 'r');
+}
+
+/**
+ * Length of the complete response at the front of buf, 0 while incomplete.
+ * Raw responses have a fixed size; HTTP ones end after Content-Length.
+ */
+static size_t completeResponse(Buffer *buf)
+{
+    if (g_config.protocol != "http")
+    {
+        return buf->readableBytes() >= g_config.responseSize ? g_config.responseSize : 0;
+    }
+    const char *headerEnd = buf->findSeq("\r\n\r\n", 4);
+    if (headerEnd == nullptr)
+    {
+        return 0;
+    }
+    static const char kContentLength[] = "Content-Length:";
+    const char *field = buf->findSeq(kContentLength, sizeof kContentLength - 1);
+    size_t bodyLen = 0;
+    if (field != nullptr && field < headerEnd)
+    {
+        bodyLen = ::strtoul(field + sizeof kContentLength - 1, nullptr, 10);
+    }
+    size_t total = headerEnd + 4 - buf->peek() + bodyLen;
+    return buf->readableBytes() >= total ? total : 0;
+}
+
+static void deleteClientLater(EventLoop *loop, TcpClient *client)
+{
+    // we are inside one of its callbacks
+    loop->queueInLoop([client]()
+                      { delete client; });
+}
+
+class PingPongSession
+{
+public:
+    PingPongSession(Worker *worker, int id)
+        : worker_(worker),
+          client_(worker->loop, *g_serverAddr, "pingpong" + std::to_string(id))
+    {
+        client_.setConnectionCallback([this](const TcpConnectionPtr &conn)
+                                      {
+                                          if (conn->connected())
+                                          {
+                                              conn->send(makeRequest());
+                                          }
+                                      });
+        client_.setMessageCallback([this](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                                   {
+                                       if (worker_->measuring)
+                                       {
+                                           worker_->bytes += buf->readableBytes();
+                                       }
+                                       conn->send(buf);
+                                   });
+        client_.connect();
+    }
+
+private:
+    Worker *worker_;
+    TcpClient client_;
+};
+
+class RequestSession
+{
+public:
+    RequestSession(Worker *worker, int id)
+        : worker_(worker),
+          request_(makeRequest()),
+          client_(worker->loop, *g_serverAddr, "request" + std::to_string(id))
+    {
+        client_.setConnectionCallback([this](const TcpConnectionPtr &conn)
+                                      {
+                                          if (conn->connected())
+                                          {
+                                              for (int i = 0; i < g_config.pipeline; ++i)
+                                              {
+                                                  send(conn);
+                                              }
+                                          }
+                                          else if (worker_->running)
+                                          {
+                                              ++worker_->errors;
+                                          }
+                                      });
+        client_.setMessageCallback(std::bind(&RequestSession::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+        client_.connect();
+    }
+
+private:
+    void send(const TcpConnectionPtr &conn)
+    {
+        sentAt_.push_back(nowNs());
+        conn->send(request_.data(), request_.size());
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+    {
+        size_t len;
+        while (!sentAt_.empty() && (len = completeResponse(buf)) > 0)
+        {
+            buf->retrieve(len);
+            if (worker_->measuring)
+            {
+                worker_->latency.record(nowNs() - sentAt_.front());
+                ++worker_->requests;
+                worker_->bytes += len;
+            }
+            sentAt_.pop_front();
+            if (worker_->running)
+            {
+                send(conn);
+            }
+        }
+    }
+
+    Worker *worker_;
+    const std::string request_;
+    std::deque<uint64_t> sentAt_;
+    TcpClient client_;
+};
+
+// like RequestSession, but borrows a connection from the loop's pool per request
+class PooledSession
+{
+public:
+    explicit PooledSession(Worker *worker)
+        : worker_(worker),
+          request_(makeRequest()),
+          sentAt_(0)
+    {
+        issue();
+    }
+
+private:
+    void issue()
+    {
+        sentAt_ = nowNs();
+        worker_->pool->acquire(*g_serverAddr, [this](const TcpConnectionPtr &conn)
+                               {
+                                   if (!conn)
+                                   {
+                                       ++worker_->errors;
+                                       return;
+                                   }
+                                   conn_ = conn;
+                                   conn->setMessageCallback(std::bind(&PooledSession::onMessage, this, std::placeholders::_1,
+                                                                      std::placeholders::_2, std::placeholders::_3));
+                                   conn->send(request_.data(), request_.size());
+                               });
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+    {
+        size_t len = completeResponse(buf);
+        if (len == 0)
+        {
+            return;
+        }
+        buf->retrieve(len);
+        if (worker_->measuring)
+        {
+            worker_->latency.record(nowNs() - sentAt_);
+            ++worker_->requests;
+            worker_->bytes += len;
+        }
+        conn_.reset();
+        worker_->pool->release(conn);
+        if (worker_->running)
+        {
+            issue();
+        }
+    }
+
+    Worker *worker_;
+    const std::string request_;
+    uint64_t sentAt_;
+    TcpConnectionPtr conn_;
+};
+
+class ChurnSession
+{
+public:
+    ChurnSession(Worker *worker, int id)
+        : worker_(worker),
+          id_(id),
+          request_(makeRequest()),
+          serial_(0),
+          connectStart_(0),
+          responded_(false)
+    {
+        start();
+    }
+
+private:
+    void start()
+    {
+        client_.reset(new TcpClient(worker_->loop, *g_serverAddr,
+                                    "churn" + std::to_string(id_) + "." + std::to_string(serial_++)));
+        client_->setConnectionCallback(std::bind(&ChurnSession::onConnection, this, std::placeholders::_1));
+        client_->setMessageCallback(std::bind(&ChurnSession::onMessage, this, std::placeholders::_1,
+                                              std::placeholders::_2, std::placeholders::_3));
+        responded_ = false;
+        connectStart_ = nowNs();
+        client_->connect();
+    }
+
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            if (worker_->measuring)
+            {
+                worker_->connectLatency.record(nowNs() - connectStart_);
+            }
+            conn->send(request_.data(), request_.size());
+            return;
+        }
+        if (worker_->measuring)
+        {
+            if (responded_)
+            {
+                ++worker_->connects;
+            }
+            else
+            {
+                ++worker_->errors;
+            }
+        }
+        deleteClientLater(worker_->loop, client_.release());
+        if (worker_->running)
+        {
+            start();
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+    {
+        size_t len = completeResponse(buf);
+        if (len == 0)
+        {
+            return;
+        }
+        buf->retrieve(len);
+        responded_ = true;
+        if (worker_->measuring)
+        {
+            worker_->latency.record(nowNs() - connectStart_);
+            ++worker_->requests;
+        }
+        conn->shutdown(); // the server closes in turn, which brings us to onConnection
+    }
+
+    Worker *worker_;
+    const int id_;
+    const std::string request_;
+    int serial_;
+    uint64_t connectStart_;
+    bool responded_;
+    std::unique_ptr<TcpClient> client_;
+};
+
+class IdleSession
+{
+public:
+    IdleSession(Worker *worker, int id)
+        : client_(worker->loop, *g_serverAddr, "idle" + std::to_string(id))
+    {
+        client_.setConnectionCallback([](const TcpConnectionPtr &conn)
+                                      {
+                                          if (conn->connected())
+                                          {
+                                              ++g_established;
+                                          }
+                                      });
+        client_.connect();
+    }
+
+private:
+    TcpClient client_;
+};
+
+// runs f in every worker's loop and waits until all have run it
+static void runInAllWorkers(const std::vector<std::unique_ptr<Worker>> &workers,
+                            const std::function<void(Worker *)> &f)
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t remaining = workers.size();
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        Worker *worker = workers[i].get();
+        worker->loop->runInLoop([&, worker]()
+                                {
+                                    f(worker);
+                                    std::lock_guard<std::mutex> lock(mutex);
+                                    if (--remaining == 0)
+                                    {
+                                        cond.notify_one();
+                                    }
+                                });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&]()
+              { return remaining == 0; });
+}
+
+int main(int argc, char **argv)
+{
+    Options options(argc, argv);
+    g_config.host = options.get("host", "127.0.0.1", "server address");
+    int port = options.getInt("port", 9981, "server port");
+    int threads = options.getInt("threads", 1, "client loop threads");
+    int connections = options.getInt("connections", 1, "concurrent connections (pool: concurrent requests)");
+    g_config.scenario = options.get("scenario", "pingpong", "pingpong|latency|churn|idle");
+    g_config.protocol = options.get("protocol", "raw", "raw|http, the request/response format of latency and churn");
+    g_config.path = options.get("path", "/", "http: request path");
+    g_config.size = options.getInt("size", 64, "raw: request bytes");
+    long responseSize = options.getInt("response-size", 0, "raw: response bytes, 0 means --size");
+    g_config.pipeline = options.getInt("pipeline", 1, "latency: requests in flight per connection");
+    g_config.pool = options.getInt("pool", 0, "latency: borrow connections from a ConnectionPool");
+    double duration = options.getDouble("duration", 5, "measured seconds");
+    double warmup = options.getDouble("warmup", 1, "seconds before measuring");
+    int serverPid = options.getInt("server-pid", 0, "sample CPU time and RSS of this process");
+    bool pin = options.getInt("pin", 0, "pin client loops to CPUs");
+    std::string label = options.get("label", "", "copied to the output, to tag runs");
+    options.checkUnknown(argv[0]);
+    g_config.responseSize = responseSize > 0 ? responseSize : g_config.size;
+    if (g_config.pipeline < 1 || connections < 1 || threads < 1)
+    {
+        fprintf(stderr, "--pipeline, --connections and --threads must be positive\n");
+        return 2;
+    }
+
+    Logger::setLogLevel(ERROR);
+    Logger::setOutput(logToStderr);
+    ::signal(SIGPIPE, SIG_IGN);
+    InetAddress serverAddr(port, g_config.host);
+    g_serverAddr = &serverAddr;
+
+    EventLoop loop;
+    EventLoopThreadPool pool(&loop, "loadgen");
+    pool.setThreadNum(threads);
+    pool.setAutoCpuAffinity(pin);
+    pool.start();
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (EventLoop *ioLoop : pool.getAllLoops())
+    {
+        workers.emplace_back(new Worker(ioLoop));
+    }
+
+    ProcStats serverStart;
+    if (serverPid > 0 && !readProcStats(serverPid, &serverStart))
+    {
+        fprintf(stderr, "cannot read /proc/%d\n", serverPid);
+        return 1;
+    }
+
+    // sessions live until the process exits
+    int perWorker = (connections + workers.size() - 1) / workers.size();
+    for (int i = 0; i < connections; ++i)
+    {
+        Worker *worker = workers[i % workers.size()].get();
+        worker->loop->runInLoop([worker, i, perWorker]()
+                                {
+                                    const std::string &scenario = g_config.scenario;
+                                    if (scenario == "pingpong")
+                                    {
+                                        new PingPongSession(worker, i);
+                                    }
+                                    else if (scenario == "latency" && g_config.pool)
+                                    {
+                                        if (!worker->pool)
+                                        {
+                                            worker->pool.reset(new ConnectionPool(worker->loop, "loadgen"));
+                                            worker->pool->setMaxTotal(perWorker);
+                                            worker->pool->setMaxIdle(perWorker);
+                                        }
+                                        new PooledSession(worker);
+                                    }
+                                    else if (scenario == "latency")
+                                    {
+                                        new RequestSession(worker, i);
+                                    }
+                                    else if (scenario == "churn")
+                                    {
+                                        new ChurnSession(worker, i);
+                                    }
+                                    else
+                                    {
+                                        new IdleSession(worker, i);
+                                    }
+                                });
+    }
+
+    JsonWriter json;
+    json.add("program", "loadgen")
+        .add("scenario", g_config.scenario)
+        .add("label", label)
+        .add("threads", threads)
+        .add("connections", connections);
+
+    if (g_config.scenario == "idle")
+    {
+        // measure as soon as everything is connected, or give up after --duration
+        uint64_t started = nowNs();
+        loop.runEvery(0.01, [&]()
+                      {
+                          double elapsed = (nowNs() - started) / 1e9;
+                          if (g_established < connections && elapsed < duration)
+                          {
+                              return;
+                          }
+                          json.add("established", g_established.load())
+                              .add("connect_all_s", elapsed);
+                          ProcStats serverEnd;
+                          if (serverPid > 0 && readProcStats(serverPid, &serverEnd) && g_established > 0)
+                          {
+                              json.beginObject("server")
+                                  .add("rss_kb_before", serverStart.rssKb)
+                                  .add("rss_kb_after", serverEnd.rssKb)
+                                  .add("bytes_per_connection", (serverEnd.rssKb - serverStart.rssKb) * 1024.0 / g_established)
+                                  .endObject();
+                          }
+                          printf("%s\n", json.str().c_str());
+                          fflush(stdout);
+                          ::_exit(0); // the kernel closes the connections
+                      });
+        loop.loop();
+    }
+
+    uint64_t measureStart = 0;
+    loop.runAfter(warmup, [&]()
+                  {
+                      runInAllWorkers(workers, [](Worker *worker)
+                                      {
+                                          worker->reset();
+                                          worker->measuring = true;
+                                      });
+                      if (serverPid > 0)
+                      {
+                          readProcStats(serverPid, &serverStart);
+                      }
+                      measureStart = nowNs();
+                  });
+    loop.runAfter(warmup + duration, [&]()
+                  {
+                      Worker total(nullptr);
+                      std::mutex mutex;
+                      runInAllWorkers(workers, [&](Worker *worker)
+                                      {
+                                          worker->measuring = false;
+                                          worker->running = false;
+                                          std::lock_guard<std::mutex> lock(mutex);
+                                          total.latency.merge(worker->latency);
+                                          total.connectLatency.merge(worker->connectLatency);
+                                          total.requests += worker->requests;
+                                          total.bytes += worker->bytes;
+                                          total.connects += worker->connects;
+                                          total.errors += worker->errors;
+                                      });
+                      double seconds = (nowNs() - measureStart) / 1e9;
+                      json.add("protocol", g_config.protocol)
+                          .add("size", static_cast<uint64_t>(g_config.size))
+                          .add("response_size", static_cast<uint64_t>(g_config.responseSize))
+                          .add("pipeline", g_config.pipeline)
+                          .add("pool", g_config.pool)
+                          .add("duration_s", seconds)
+                          .add("requests", total.requests)
+                          .add("requests_per_sec", total.requests / seconds)
+                          .add("bytes", total.bytes)
+                          .add("mb_per_sec", total.bytes / seconds / (1024 * 1024))
+                          .add("connects", total.connects)
+                          .add("connects_per_sec", total.connects / seconds)
+                          .add("errors", total.errors);
+                      if (total.latency.count() > 0)
+                      {
+                          total.latency.toJson(&json, "latency_us", 1000.0);
+                      }
+                      if (total.connectLatency.count() > 0)
+                      {
+                          total.connectLatency.toJson(&json, "connect_latency_us", 1000.0);
+                      }
+                      ProcStats serverEnd;
+                      if (serverPid > 0 && readProcStats(serverPid, &serverEnd))
+                      {
+                          double cpu = serverEnd.cpuSeconds - serverStart.cpuSeconds;
+                          double gb = total.bytes / 1e9;
+                          json.beginObject("server")
+                              .add("cpu_s", cpu)
+                              .add("cpu_utilization", cpu / seconds)
+                              .add("cpu_s_per_gb", gb > 0 ? cpu / gb : 0.0)
+                              .add("rss_kb", serverEnd.rssKb)
+                              .endObject();
+                      }
+                      printf("%s\n", json.str().c_str());
+                      fflush(stdout);
+                      ::_exit(0); // sessions are spread over running loops, let the kernel close them
+                  });
+    loop.loop();
+    return 0;
+}
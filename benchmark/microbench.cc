@@ -0,0 +1,825 @@
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AsyncLogging.h"
+#include "BenchUtil.h"
+#include "Buffer.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "EventLoopThreadPool.h"
+#include "InetAddress.h"
+#include "LengthHeaderCodec.h"
+#include "Logger.h"
+#include "LoopMetrics.h"
+#include "TcpConnection.h"
+#include "TimingWheel.h"
+
+/**
+ * Per-operation cost of the building blocks on the hot path, the baseline
+ * for changes to them. Every benchmark is warmed up, calibrated to run for
+ * --min-time seconds and repeated --repetitions times; the median ns/op is
+ * reported with the spread of the repetitions and the heap allocations per
+ * operation, counted by replacing the global operator new.
+ *
+ *   ./microbench [--filter buffer] [--json]
+ *
+ * The calling thread is pinned to --cpu and loop threads to --peer-cpu, so
+ * cross-thread numbers don't depend on where the scheduler puts them.
+ */
+
+static std::atomic<uint64_t> g_allocations(0);
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = ::malloc(size ? size : 1);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return ::malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+// the replacements pair malloc with free, gcc can't see that through operator new
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept { ::free(p); }
+void operator delete[](void *p) noexcept { ::free(p); }
+void operator delete(void *p, size_t) noexcept { ::free(p); }
+void operator delete[](void *p, size_t) noexcept { ::free(p); }
+
+static void pinTo(int cpu)
+{
+    if (cpu < 0)
+    {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (::sched_setaffinity(0, sizeof set, &set) < 0)
+    {
+        fprintf(stderr, "microbench: cannot pin to cpu %d errno:%d\n", cpu, errno);
+    }
+}
+
+// keeps the compiler from dropping a computation whose result is unused
+template <typename T>
+static inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static void nullOutput(const char *, size_t) {}
+
+/**
+ * Runs one body(n) per batch, so the std::function call is amortized over n
+ * operations. An optional counter (e.g. loop wakeups) is sampled around the
+ * measured repetitions and reported per operation next to the timings.
+ */
+class Runner
+{
+public:
+    using Body = std::function<void(uint64_t n)>;
+    using Counter = std::function<uint64_t()>;
+
+    Runner(const std::string &filter, double minTime, double warmup, int repetitions, bool json)
+        : filter_(filter),
+          minTime_(minTime),
+          warmup_(warmup),
+          repetitions_(repetitions),
+          json_(json)
+    {
+        if (!json_)
+        {
+            printf("%-42s %12s %12s %8s %10s  %s\n", "benchmark", "ns/op", "min ns/op", "spread", "allocs/op", "extra");
+        }
+    }
+
+    // for benchmarks whose setup is too expensive to do for nothing
+    bool selected(const std::string &name) const
+    {
+        return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    void measure(const std::string &name, const Body &body,
+                 const char *counterName = nullptr, const Counter &counter = Counter())
+    {
+        if (!selected(name))
+        {
+            return;
+        }
+        // warm up caches, pools and branch predictors while calibrating n; the
+        // fastest batch decides, so one preemption can't shrink n to a handful
+        uint64_t n = 1;
+        double target = warmup_ > 0 ? warmup_ : minTime_ / 10;
+        double spent = 0;
+        double bestNsPerOp = 0;
+        for (;;)
+        {
+            uint64_t start = nowNs();
+            body(n);
+            uint64_t elapsedNs = nowNs() - start;
+            spent += elapsedNs / 1e9;
+            double perOp = static_cast<double>(elapsedNs) / n;
+            bestNsPerOp = bestNsPerOp > 0 && bestNsPerOp < perOp ? bestNsPerOp : perOp;
+            // an empty body never takes long enough, give up growing at some point
+            if ((spent >= target && elapsedNs / 1e9 >= minTime_ / 10) || n >= (1ull << 36))
+            {
+                break;
+            }
+            n = elapsedNs < 100000 ? n * 10 : n * 2;
+        }
+        n = std::max<uint64_t>(1, static_cast<uint64_t>(minTime_ * 1e9 / std::max(bestNsPerOp, 0.01)));
+
+        std::vector<double> nsPerOp;
+        uint64_t allocsBefore = g_allocations.load(std::memory_order_relaxed);
+        uint64_t counterBefore = counter ? counter() : 0;
+        for (int i = 0; i < repetitions_; ++i)
+        {
+            uint64_t start = nowNs();
+            body(n);
+            nsPerOp.push_back(static_cast<double>(nowNs() - start) / n);
+        }
+        uint64_t ops = n * repetitions_;
+        double allocs = static_cast<double>(g_allocations.load(std::memory_order_relaxed) - allocsBefore) / ops;
+        double extra = counter ? static_cast<double>(counter() - counterBefore) / ops : 0;
+
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+        double median = nsPerOp[nsPerOp.size() / 2];
+        double spread = median > 0 ? (nsPerOp.back() - nsPerOp.front()) / median * 100 : 0;
+        if (json_)
+        {
+            JsonWriter json;
+            json.add("program", "microbench")
+                .add("benchmark", name)
+                .add("iterations", n)
+                .add("repetitions", repetitions_)
+                .add("ns_per_op", median)
+                .add("min_ns_per_op", nsPerOp.front())
+                .add("max_ns_per_op", nsPerOp.back())
+                .add("ops_per_sec", median > 0 ? 1e9 / median : 0.0)
+                .add("allocs_per_op", allocs);
+            if (counterName)
+            {
+                json.add(counterName, extra);
+            }
+            printf("%s\n", json.str().c_str());
+        }
+        else
+        {
+            char extraText[64] = "";
+            if (counterName)
+            {
+                snprintf(extraText, sizeof extraText, "%s=%.3f", counterName, extra);
+            }
+            printf("%-42s %12.1f %12.1f %7.1f%% %10.2f  %s\n",
+                   name.c_str(), median, nsPerOp.front(), spread, allocs, extraText);
+        }
+        fflush(stdout);
+    }
+
+private:
+    const std::string filter_;
+    const double minTime_;
+    const double warmup_;
+    const int repetitions_;
+    const bool json_;
+};
+
+static void benchBuffer(Runner &runner)
+{
+    std::string payload(64 * 1024, 'x');
+    for (size_t size : {64, 4096})
+    {
+        Buffer buffer;
+        runner.measure("buffer_append_retrieve_" + std::to_string(size), [&](uint64_t n)
+                       {
+                           for (uint64_t i = 0; i < n; ++i)
+                           {
+                               buffer.append(payload.data(), size);
+                               buffer.retrieve(size);
+                           }
+                       });
+    }
+
+    // ~100 bytes stay readable, so writerIndex_ creeps up until makeSpace moves them to the front
+    {
+        Buffer buffer;
+        buffer.append(payload.data(), 100);
+        runner.measure("buffer_append_compact_600", [&](uint64_t n)
+                       {
+                           for (uint64_t i = 0; i < n; ++i)
+                           {
+                               buffer.append(payload.data(), 600);
+                               buffer.retrieve(600);
+                           }
+                       });
+    }
+
+    // a fresh Buffer grown to 64KB in 1KB appends, every makeSpace reallocation included
+    runner.measure("buffer_grow_64k", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           Buffer buffer;
+                           for (int chunk = 0; chunk < 64; ++chunk)
+                           {
+                               buffer.append(payload.data(), 1024);
+                           }
+                           doNotOptimize(buffer.readableBytes());
+                       }
+                   });
+
+    runner.measure("buffer_append_int32_read", [&](uint64_t n)
+                   {
+                       Buffer buffer;
+                       int64_t sum = 0;
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           buffer.appendInt32(static_cast<int32_t>(i));
+                           sum += buffer.readInt32();
+                       }
+                       doNotOptimize(sum);
+                   });
+
+    // readFd from a pipe, against a plain read() of the same bytes as the floor
+    int fds[2];
+    if (::pipe(fds) < 0)
+    {
+        fprintf(stderr, "microbench: pipe failed errno:%d\n", errno);
+        return;
+    }
+    std::vector<char> sink(64 * 1024);
+    for (size_t size : {1024, 16384})
+    {
+        runner.measure("pipe_write_read_" + std::to_string(size), [&](uint64_t n)
+                       {
+                           for (uint64_t i = 0; i < n; ++i)
+                           {
+                               ssize_t w = ::write(fds[1], payload.data(), size);
+                               ssize_t r = ::read(fds[0], sink.data(), sink.size());
+                               doNotOptimize(w + r);
+                           }
+                       });
+        Buffer buffer;
+        runner.measure("buffer_readfd_" + std::to_string(size), [&](uint64_t n)
+                       {
+                           int savedErrno = 0;
+                           for (uint64_t i = 0; i < n; ++i)
+                           {
+                               ssize_t w = ::write(fds[1], payload.data(), size);
+                               buffer.readFd(fds[0], &savedErrno);
+                               buffer.retrieveAll();
+                               doNotOptimize(w);
+                           }
+                       });
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+static void benchFind(Runner &runner)
+{
+    std::string header = "GET /index.html HTTP/1.1\r\n"
+                         "Host: www.example.com\r\n"
+                         "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+                         "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                         "Accept-Language: en-US,en;q=0.5\r\n"
+                         "Accept-Encoding: gzip, deflate, br\r\n"
+                         "Connection: keep-alive\r\n"
+                         "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark\r\n"
+                         "\r\n";
+    Buffer buffer;
+    buffer.append(header.data(), header.size());
+    static const char kEnd[] = "\r\n\r\n";
+    runner.measure(std::string("find_header_end_") + Buffer::findImplementation(), [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           doNotOptimize(buffer.findSeq(kEnd, 4));
+                       }
+                   });
+    runner.measure("find_header_end_std_search", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           doNotOptimize(std::search(buffer.peek(), buffer.peek() + buffer.readableBytes(), kEnd, kEnd + 4));
+                       }
+                   });
+    runner.measure("find_crlf_lines", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           const char *start = buffer.peek();
+                           const char *crlf;
+                           while ((crlf = buffer.findCRLF(start)) != nullptr)
+                           {
+                               start = crlf + 2;
+                           }
+                           doNotOptimize(start);
+                       }
+                   });
+}
+
+static void benchCodec(Runner &runner, EventLoop *loop)
+{
+    static const int kFrames = 64;
+    int sv[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    ::close(sv[1]);
+    TcpConnectionPtr conn(new TcpConnection(loop, "codec", sv[0], InetAddress(), InetAddress()));
+    uint64_t frames = 0;
+    LengthHeaderCodec codec([&frames](const TcpConnectionPtr &, const char *, size_t len, Timestamp)
+                            { frames += len > 0; });
+    std::string payload(64, 'p');
+
+    Buffer encoded;
+    runner.measure("codec_encode_64", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           encoded.retrieveAll();
+                           encoded.append(payload.data(), payload.size());
+                           codec.encode(&encoded);
+                       }
+                   });
+
+    std::string wire;
+    for (int i = 0; i < kFrames; ++i)
+    {
+        wire.append(encoded.peek(), encoded.readableBytes());
+    }
+    Buffer input;
+    // one read delivering 64 frames of 64 bytes, decoded in place
+    runner.measure("codec_decode_64x64", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           input.append(wire.data(), wire.size());
+                           codec.onMessage(conn, &input, Timestamp());
+                       }
+                   });
+    doNotOptimize(frames);
+}
+
+static void benchLoopThread(Runner &runner, int peerCpu)
+{
+    EventLoopThread thread;
+    thread.setCpu(peerCpu);
+    EventLoop *loop = thread.startLoop();
+    Runner::Counter wakeups = [loop]()
+    {
+        return loop->metrics().iterations.value();
+    };
+
+    // post, then wait for the loop to run it: the latency of handing work over
+    std::atomic<uint64_t> done(0);
+    runner.measure("run_in_loop_round_trip", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           uint64_t expected = done.load(std::memory_order_relaxed) + 1;
+                           loop->runInLoop([&done]()
+                                           { done.fetch_add(1, std::memory_order_release); });
+                           while (done.load(std::memory_order_acquire) != expected)
+                           {
+                               ::sched_yield();
+                           }
+                       }
+                   },
+                   "wakeups_per_op", wakeups);
+
+    // producers post without waiting, the loop drains in batches
+    for (int producers : {1, 2, 4, 8, 16, 32})
+    {
+        runner.measure("queue_in_loop_producers_" + std::to_string(producers), [&](uint64_t n)
+                       {
+                           uint64_t target = done.load(std::memory_order_relaxed) + n;
+                           std::vector<std::thread> threads;
+                           for (int p = 0; p < producers; ++p)
+                           {
+                               uint64_t count = n / producers + (static_cast<uint64_t>(p) < n % producers);
+                               threads.emplace_back([&done, loop, count]()
+                                                    {
+                                                        for (uint64_t i = 0; i < count; ++i)
+                                                        {
+                                                            loop->queueInLoop([&done]()
+                                                                              { done.fetch_add(1, std::memory_order_release); });
+                                                        }
+                                                    });
+                           }
+                           for (std::thread &t : threads)
+                           {
+                               t.join();
+                           }
+                           while (done.load(std::memory_order_acquire) != target)
+                           {
+                               ::sched_yield();
+                           }
+                       },
+                       "wakeups_per_op", wakeups);
+    }
+}
+
+// loop on the calling thread, never run: the Poller and Channel are driven directly
+static void benchChannel(Runner &runner, EventLoop *loop)
+{
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Channel channel(loop, fd);
+
+    channel.enableReading();
+    runner.measure("poller_update_mod", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           if (i & 1)
+                           {
+                               channel.disableWriting();
+                           }
+                           else
+                           {
+                               channel.enableWriting();
+                           }
+                       }
+                   });
+    if (channel.isWriting())
+    {
+        channel.disableWriting();
+    }
+    runner.measure("poller_update_add_del", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           if (i & 1)
+                           {
+                               channel.enableReading();
+                           }
+                           else
+                           {
+                               channel.disableAll();
+                           }
+                       }
+                   });
+    channel.disableAll();
+    channel.remove();
+
+    uint64_t reads = 0;
+    channel.setReadCallback([&reads](Timestamp)
+                            { ++reads; });
+    channel.set_revents(EPOLLIN);
+    runner.measure("channel_handle_event", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           channel.handleEvent(Timestamp());
+                       }
+                   });
+    std::shared_ptr<int> owner(new int(0));
+    channel.tie(owner);
+    runner.measure("channel_handle_event_tied", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           channel.handleEvent(Timestamp());
+                       }
+                   });
+    doNotOptimize(reads);
+    ::close(fd);
+}
+
+// what TcpServer does per accepted connection, minus the accept itself
+static void benchConnection(Runner &runner, EventLoop *loop)
+{
+    int sv[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    InetAddress localAddr(9981);
+    InetAddress peerAddr(54321);
+    ConnectionCallback onConnection = [](const TcpConnectionPtr &) {};
+    uint64_t nextId = 0;
+    runner.measure("tcp_connection_create_destroy", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           char name[64];
+                           snprintf(name, sizeof name, "bench-%s#%llu", localAddr.toIpPort().c_str(),
+                                    static_cast<unsigned long long>(++nextId));
+                           // the connection owns and closes its fd
+                           TcpConnectionPtr conn(new TcpConnection(loop, name, ::dup(sv[0]), localAddr, peerAddr));
+                           conn->setConnectionCallback(onConnection);
+                           conn->connectEstablished();
+                           conn->connectDestroyed();
+                       }
+                   });
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+static void benchTimingWheel(Runner &runner, EventLoop *loop)
+{
+    TimingWheel *wheel = loop->timingWheel();
+    TimingWheel::Node node;
+    wheel->add(&node, 60, []() {});
+    runner.measure("timing_wheel_touch", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           node.touch();
+                           doNotOptimize(node);
+                       }
+                   });
+    runner.measure("timing_wheel_add_remove", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           wheel->add(&node, 60, []() {});
+                           wheel->remove(&node);
+                       }
+                   });
+}
+
+// runs f(i) in loops[i] for every loop and waits until all of them are done
+static void runInAllLoops(const std::vector<EventLoop *> &loops, const std::function<void(size_t)> &f)
+{
+    std::atomic<size_t> pending(loops.size());
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        loops[i]->runInLoop([&f, &pending, i]()
+                            {
+                                f(i);
+                                pending.fetch_sub(1, std::memory_order_release);
+                            });
+    }
+    while (pending.load(std::memory_order_acquire) != 0)
+    {
+        ::sched_yield();
+    }
+}
+
+/**
+ * The idle-timeout bookkeeping a message costs at scale: `nodes` armed
+ * connections spread over the pool's loops, each loop touching its own in a
+ * strided order so consecutive touches land on different cache lines, while
+ * the wheels keep ticking.
+ */
+static void benchTimingWheelLoops(Runner &runner, EventLoop *baseLoop, int numLoops, int nodes, int peerCpu)
+{
+    const size_t perLoop = nodes / numLoops;
+    std::string suffix = "_" + std::to_string(perLoop * numLoops) + "_nodes_" + std::to_string(numLoops) + "_loops";
+    if (perLoop == 0 || (!runner.selected("timing_wheel_touch" + suffix) && !runner.selected("timing_wheel_rearm" + suffix)))
+    {
+        return;
+    }
+    EventLoopThreadPool pool(baseLoop, "wheel");
+    pool.setThreadNum(numLoops);
+    // one CPU per loop, as a server would run them
+    pool.setAutoCpuAffinity(peerCpu >= 0);
+    pool.start();
+    std::vector<EventLoop *> loops = pool.getAllLoops();
+    const size_t kStride = 7919; // prime, so the walk visits every node
+    std::vector<std::unique_ptr<TimingWheel::Node[]>> loopNodes(loops.size());
+    std::vector<size_t> cursors(loops.size(), 0);
+
+    // allocated and armed by the owning loop, as TcpConnection does
+    runInAllLoops(loops, [&](size_t i)
+                  {
+                      loopNodes[i].reset(new TimingWheel::Node[perLoop]);
+                      TimingWheel *wheel = loops[i]->timingWheel();
+                      for (size_t j = 0; j < perLoop; ++j)
+                      {
+                          wheel->add(&loopNodes[i][j], 60, []() {});
+                      }
+                  });
+
+    runner.measure("timing_wheel_touch" + suffix, [&](uint64_t n)
+                   {
+                       runInAllLoops(loops, [&](size_t i)
+                                     {
+                                         TimingWheel::Node *base = loopNodes[i].get();
+                                         size_t cursor = cursors[i];
+                                         for (uint64_t k = i; k < n; k += loops.size())
+                                         {
+                                             base[cursor].touch();
+                                             cursor += kStride;
+                                             cursor = cursor >= perLoop ? cursor % perLoop : cursor;
+                                         }
+                                         cursors[i] = cursor;
+                                     });
+                   });
+    runner.measure("timing_wheel_rearm" + suffix, [&](uint64_t n)
+                   {
+                       runInAllLoops(loops, [&](size_t i)
+                                     {
+                                         TimingWheel::Node *base = loopNodes[i].get();
+                                         TimingWheel *wheel = loops[i]->timingWheel();
+                                         size_t cursor = cursors[i];
+                                         for (uint64_t k = i; k < n; k += loops.size())
+                                         {
+                                             wheel->add(&base[cursor], 60, []() {});
+                                             cursor += kStride;
+                                             cursor = cursor >= perLoop ? cursor % perLoop : cursor;
+                                         }
+                                         cursors[i] = cursor;
+                                     });
+                   });
+
+    // nodes unlink themselves, which has to happen in their loop
+    runInAllLoops(loops, [&](size_t i)
+                  { loopNodes[i].reset(); });
+}
+
+static void benchLogger(Runner &runner)
+{
+    int savedLevel = Logger::logLevel();
+    Logger::setOutput(nullOutput);
+    Logger::setLogLevel(INFO);
+    runner.measure("log_info_formatted", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s\n",
+                                    "bench", "bench-127.0.0.1:9981#1", "127.0.0.1:54321");
+                       }
+                   });
+    Logger::setLogLevel(ERROR);
+    runner.measure("log_info_disabled", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s\n",
+                                    "bench", "bench-127.0.0.1:9981#1", "127.0.0.1:54321");
+                           // reload the level each time, as a real call site between other code does
+                           doNotOptimize(i);
+                       }
+                   });
+    Logger::setLogLevel(savedLevel);
+    Logger::setOutput(logToStderr);
+}
+
+static AsyncLogging *g_asyncLog = nullptr;
+
+static void asyncOutput(const char *msg, size_t len)
+{
+    g_asyncLog->append(msg, len);
+}
+
+/**
+ * Lines per second the AsyncLogging front end takes from several loop
+ * threads at once, all contending for its one mutex (ops_per_sec in --json).
+ * The files go to a fresh directory under logDir and are removed afterwards.
+ */
+static void benchAsyncLogging(Runner &runner, EventLoop *baseLoop, int numLoops, const std::string &logDir, int peerCpu)
+{
+    const std::string name = "async_logging_" + std::to_string(numLoops) + "_loops";
+    if (!runner.selected(name))
+    {
+        return;
+    }
+    std::string dirTemplate = logDir + "/microbench.XXXXXX";
+    std::vector<char> dir(dirTemplate.begin(), dirTemplate.end());
+    dir.push_back('\0');
+    if (::mkdtemp(dir.data()) == nullptr)
+    {
+        fprintf(stderr, "cannot create a log directory under %s: %s\n", logDir.c_str(), strerror(errno));
+        return;
+    }
+
+    EventLoopThreadPool pool(baseLoop, "logging");
+    pool.setThreadNum(numLoops);
+    pool.setAutoCpuAffinity(peerCpu >= 0);
+    pool.start();
+    std::vector<EventLoop *> loops = pool.getAllLoops();
+
+    int savedLevel = Logger::logLevel();
+    {
+        AsyncLogging log(std::string(dir.data()) + "/bench", 500 * 1000 * 1000);
+        log.start();
+        g_asyncLog = &log;
+        Logger::setOutput(asyncOutput);
+        Logger::setLogLevel(INFO);
+        runner.measure(name, [&](uint64_t n)
+                       {
+                           runInAllLoops(loops, [&](size_t i)
+                                         {
+                                             for (uint64_t k = i; k < n; k += loops.size())
+                                             {
+                                                 LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s\n",
+                                                          "bench", "bench-127.0.0.1:9981#1", "127.0.0.1:54321");
+                                             }
+                                         });
+                       });
+        Logger::setLogLevel(savedLevel);
+        Logger::setOutput(logToStderr);
+        log.stop();
+        g_asyncLog = nullptr;
+    }
+
+    DIR *d = ::opendir(dir.data());
+    if (d)
+    {
+        while (dirent *entry = ::readdir(d))
+        {
+            if (entry->d_name[0] != '.')
+            {
+                ::unlink((std::string(dir.data()) + "/" + entry->d_name).c_str());
+            }
+        }
+        ::closedir(d);
+    }
+    ::rmdir(dir.data());
+}
+
+static void benchMetrics(Runner &runner)
+{
+    LoopMetrics metrics;
+    runner.measure("metrics_counter_add", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           metrics.bytesRead.add(i);
+                       }
+                   });
+    runner.measure("metrics_histogram_record", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           metrics.pollWaitUs.record(i);
+                       }
+                   });
+    runner.measure("timestamp_now", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           doNotOptimize(Timestamp::now());
+                       }
+                   });
+}
+
+int main(int argc, char **argv)
+{
+    Options options(argc, argv);
+    std::string filter = options.get("filter", "", "run only benchmarks whose name contains this");
+    double minTime = options.getDouble("min-time", 0.2, "seconds per repetition");
+    double warmup = options.getDouble("warmup", 0.1, "seconds of warm-up per benchmark");
+    int repetitions = options.getInt("repetitions", 5, "repetitions, the median is reported");
+    int cpu = options.getInt("cpu", 0, "pin the benchmark thread to this CPU, -1 to not pin");
+    int peerCpu = options.getInt("peer-cpu", ::sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 1 : 0,
+                                 "pin loop threads to this CPU, -1 to not pin");
+    int wheelNodes = options.getInt("wheel-nodes", 1000000, "armed timing wheel nodes over all loops");
+    int wheelLoops = options.getInt("wheel-loops", 4, "loops the timing wheel nodes are spread over");
+    int logLoops = options.getInt("log-loops", 8, "loop threads logging at once through AsyncLogging");
+    std::string logDir = options.get("log-dir", "/tmp", "where the AsyncLogging benchmark writes its files");
+    bool json = options.getInt("json", 0, "one JSON object per benchmark instead of a table");
+    options.checkUnknown(argv[0]);
+
+    Logger::setLogLevel(ERROR);
+    Logger::setOutput(logToStderr);
+    pinTo(cpu);
+
+    Runner runner(filter, minTime, warmup, repetitions < 1 ? 1 : repetitions, json);
+    EventLoop loop;
+    benchBuffer(runner);
+    benchFind(runner);
+    benchCodec(runner, &loop);
+    benchChannel(runner, &loop);
+    benchConnection(runner, &loop);
+    benchTimingWheel(runner, &loop);
+    benchTimingWheelLoops(runner, &loop, wheelLoops < 1 ? 1 : wheelLoops, wheelNodes, peerCpu);
+    benchLogger(runner);
+    benchAsyncLogging(runner, &loop, logLoops < 1 ? 1 : logLoops, logDir, peerCpu);
+    benchMetrics(runner);
+    benchLoopThread(runner, peerCpu);
+    return 0;
+}
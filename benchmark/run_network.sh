@@ -0,0 +1,169 @@
+#!/bin/bash
+# Runs the network benchmark matrix against localhost and appends one JSON
+# object per run to $OUT (default network_results.jsonl). Every loadgen
+# result is followed by the server's own summary line.
+#
+#   DURATION=5 THREADS=4 ./run_network.sh [scenario-group ...]
+#
+# Groups: pingpong latency http churn accept dispatch et busypoll zerocopy
+#         sendfile poller idle pool connect (default: all)
+# Build with -DCMAKE_BUILD_TYPE=Release first, the default build is unoptimized.
+
+set -e
+cd "$(dirname "$0")"
+
+OUT=${OUT:-network_results.jsonl}
+DURATION=${DURATION:-5}
+WARMUP=${WARMUP:-1}
+THREADS=${THREADS:-4}
+CLIENT_THREADS=${CLIENT_THREADS:-$THREADS}
+PORT=${PORT:-9981}
+
+SERVER_PID=
+
+start_server() {
+    ./benchserver --port "$PORT" "$@" >>"$OUT" 2>/dev/null &
+    SERVER_PID=$!
+    sleep 0.3
+}
+
+stop_server() {
+    kill -INT "$SERVER_PID"
+    wait "$SERVER_PID" || true
+    sleep 0.5 # let the port and the loopback TIME_WAITs settle
+}
+
+load() {
+    local label=$1
+    shift
+    ./loadgen --port "$PORT" --threads "$CLIENT_THREADS" --duration "$DURATION" --warmup "$WARMUP" \
+        --server-pid "$SERVER_PID" --label "$label" "$@" | tee -a "$OUT"
+}
+
+group_pingpong() {
+    start_server --threads "$THREADS"
+    for size in 64 4096 65536; do
+        for conns in 1 10 100 1000; do
+            load "pingpong size=$size conns=$conns" --scenario pingpong --size "$size" --connections "$conns"
+        done
+    done
+    stop_server
+}
+
+group_latency() {
+    for threads in 1 2 4 8; do
+        start_server --threads "$threads"
+        load "latency server_threads=$threads" --scenario latency --connections 64
+        stop_server
+    done
+    start_server --threads "$THREADS"
+    load "latency pipeline=16" --scenario latency --connections 64 --pipeline 16
+    stop_server
+}
+
+group_http() {
+    start_server --threads "$THREADS" --mode echo
+    load "echo 72B" --scenario latency --connections 64 --size 72
+    stop_server
+    start_server --threads "$THREADS" --mode http
+    load "http GET" --scenario latency --connections 64 --protocol http
+    load "http GET pipeline=16" --scenario latency --connections 64 --protocol http --pipeline 16
+    stop_server
+}
+
+group_churn() {
+    start_server --threads "$THREADS"
+    load "churn conns=64" --scenario churn --connections 64
+    stop_server
+}
+
+group_accept() {
+    for mode in single reuseport shared; do
+        for batch in 1 64; do
+            start_server --threads "$THREADS" --accept "$mode" --accept-batch "$batch"
+            load "accept=$mode batch=$batch" --scenario churn --connections 256
+            stop_server
+        done
+    done
+}
+
+# the first 3/4 of the connections are bulk transfers keeping loops busy
+group_dispatch() {
+    for policy in rr least p2c hash; do
+        start_server --threads "$THREADS" --dispatch "$policy"
+        ./loadgen --port "$PORT" --scenario pingpong --size 65536 --connections "$((THREADS * 3))" \
+            --duration "$(awk "BEGIN { print $DURATION + $WARMUP + 2 }")" --warmup 0 >/dev/null &
+        local bulk=$!
+        sleep 1
+        load "dispatch=$policy" --scenario latency --connections 16
+        wait "$bulk" || true
+        stop_server
+    done
+}
+
+group_et() {
+    for et in 0 1; do
+        start_server --threads "$THREADS" --edge-triggered "$et"
+        load "edge_triggered=$et 1MB" --scenario pingpong --size 1048576 --connections 16
+        load "edge_triggered=$et 64B" --scenario latency --connections 64
+        stop_server
+    done
+}
+
+group_busypoll() {
+    for spin in 0 50 200 1000; do
+        start_server --threads "$THREADS" --busy-poll "$spin"
+        load "busy_poll=$spin" --scenario latency --connections 1
+        stop_server
+    done
+}
+
+group_zerocopy() {
+    for threshold in 0 16384; do
+        start_server --threads "$THREADS" --zerocopy "$threshold"
+        load "zerocopy=$threshold" --scenario pingpong --size 262144 --connections 16
+        stop_server
+    done
+}
+
+group_sendfile() {
+    for sendfile in 1 0; do
+        start_server --threads "$THREADS" --mode file --sendfile "$sendfile" --file-size 1048576
+        load "sendfile=$sendfile" --scenario latency --size 1 --response-size 1048576 --connections 16
+        stop_server
+    done
+}
+
+group_poller() {
+    for poller in epoll io_uring; do
+        start_server --threads "$THREADS" --poller "$poller"
+        load "poller=$poller pingpong" --scenario pingpong --size 4096 --connections 100
+        load "poller=$poller latency" --scenario latency --connections 64
+        stop_server
+    done
+}
+
+group_idle() {
+    start_server --threads "$THREADS"
+    load "idle 10000" --scenario idle --connections 10000 --duration 30
+    stop_server
+}
+
+group_pool() {
+    start_server --threads "$THREADS"
+    load "pooled" --scenario latency --pool 1 --connections 64
+    load "connect per request" --scenario churn --connections 64
+    stop_server
+}
+
+group_connect() {
+    start_server --threads "$THREADS"
+    load "connect 2000 clients" --scenario churn --connections 2000
+    stop_server
+}
+
+GROUPS_TO_RUN=${*:-pingpong latency http churn accept dispatch et busypoll zerocopy sendfile poller idle pool connect}
+ulimit -n 65536 2>/dev/null || true
+for group in $GROUPS_TO_RUN; do
+    "group_$group"
+done
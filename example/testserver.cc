@@ -39,8 +39,8 @@ private:
 
     void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp time)
     {
-        std::string msg = buf->retrieveAllAsString();
-        conn->send(msg);
+        // same loop thread: written straight from the input buffer, no copy
+        conn->send(buf);
     }
     TcpServer server_;
     EventLoop *loop_;
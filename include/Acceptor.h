@@ -13,18 +13,46 @@ class Acceptor : noncopyable
 {
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress &)>;
+    // after the last connection of one readable event, e.g. to hand a batch over
+    using AcceptBatchCallback = std::function<void()>;
+
+    static const int kDefaultMaxAcceptsPerRead = 64;
+
     Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport);
+    /**
+     * Accept on a socket that another Acceptor already bound, sockfd is
+     * usually a dup() of that Acceptor's fd() and is owned from now on.
+     * Both wait on it with EPOLLEXCLUSIVE, so one connection wakes one loop.
+     */
+    Acceptor(EventLoop *loop, int sockfd);
     ~Acceptor();
     void setNewConnectionCallback(const NewConnectionCallback &cb) { NewConnectionCallback_ = cb; }
+    void setAcceptBatchCallback(const AcceptBatchCallback &cb) { acceptBatchCallback_ = cb; }
+    /**
+     * One readable event accepts until EAGAIN, but at most n connections so a
+     * storm can't starve the loop's other channels and timers; whatever is
+     * left keeps the socket readable for the next poll(). 1 accepts one per event.
+     * On loops with supportsCompletions() the kernel accepts, the cap doesn't apply.
+     */
+    void setMaxAcceptsPerRead(int n) { maxAcceptsPerRead_ = n > 0 ? n : 1; }
+    void setExclusive(bool on) { exclusive_ = on; } // before listen()
+    EventLoop *getLoop() const { return loop_; }
+    int fd() const { return acceptSocket_.fd(); }
     bool listenning() const { return listenning_; }
     void listen();
 
 private:
     void handleRead();
+    void handleAccepted(const Channel::Completion *accepted, size_t count);
+    void dropConnection();
 
     EventLoop *loop_;
     Socket acceptSocket_;
     Channel acceptChannel_;
     NewConnectionCallback NewConnectionCallback_;
+    AcceptBatchCallback acceptBatchCallback_;
     bool listenning_;
+    bool exclusive_;
+    int maxAcceptsPerRead_;
+    int idleFd_; // spare descriptor, given up to accept and close a connection on EMFILE
 };
\ No newline at end of file
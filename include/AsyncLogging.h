@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string.h>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+/**
+ * Asynchronous log backend with double buffering.
+ *
+ * Front-end threads append formatted lines into a preallocated 4MB buffer; the
+ * lock is held only for that memcpy. When a buffer is full it is handed to the
+ * background thread together with a spare one, which writes all full buffers
+ * to a LogFile in one batch, at least every flushInterval seconds.
+ *
+ * Usage:
+ *      AsyncLogging log("server", 500 * 1000 * 1000);
+ *      log.start();
+ *      Logger::setOutput(output); // void output(const char *msg, size_t len) { log.append(msg, len); }
+ */
+class AsyncLogging : noncopyable
+{
+public:
+    AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval = 3);
+    ~AsyncLogging();
+
+    // thread safe, called by Logger on every log line
+    void append(const char *logline, size_t len);
+
+    void start();
+    void stop();
+
+private:
+    static const size_t kBufferSize = 4000 * 1000;
+
+    class LogBuffer : noncopyable
+    {
+    public:
+        LogBuffer() : cur_(data_) {}
+
+        void append(const char *buf, size_t len)
+        {
+            ::memcpy(cur_, buf, len);
+            cur_ += len;
+        }
+        const char *data() const { return data_; }
+        size_t length() const { return static_cast<size_t>(cur_ - data_); }
+        size_t avail() const { return static_cast<size_t>(end() - cur_); }
+        void reset() { cur_ = data_; }
+
+    private:
+        const char *end() const { return data_ + sizeof data_; }
+
+        char data_[kBufferSize];
+        char *cur_;
+    };
+
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    void threadFunc();
+
+    const int flushInterval_;
+    std::atomic_bool running_;
+    const std::string basename_;
+    const off_t rollSize_;
+    Thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    BufferPtr currentBuffer_;
+    BufferPtr nextBuffer_;
+    BufferVector buffers_; // full buffers waiting for the backend
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include "noncopyable.h"
+
+/**
+ * Free list of fixed-size blocks for SegmentedBuffer, one per EventLoop.
+ * Like everything else owned by a loop it is only used from the loop thread.
+ */
+class BlockPool : noncopyable
+{
+public:
+    static const size_t kBlockSize = 16 * 1024;
+    static const size_t kDefaultMaxFree = 1024; // keep up to 16MB cached per loop
+
+    explicit BlockPool(size_t maxFree = kDefaultMaxFree);
+    ~BlockPool();
+
+    char *allocate();
+    void deallocate(char *block);
+
+    size_t freeBlocks() const { return free_.size(); }
+
+private:
+    std::vector<char *> free_;
+    const size_t maxFree_;
+};
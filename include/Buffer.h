@@ -4,25 +4,59 @@
 #include <string>
 #include <algorithm>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
 
 class Buffer
 {
 public:
     static const size_t kCheapPrepend = 8;
     static const size_t kInitialSize = 1024;
+    static const size_t kExtraReadSize = 65536; // stack spill area of readFd
 
+    /**
+     * initalSize == 0 creates a buffer without storage, it is allocated by the
+     * first append/ensureWritableBytes or handed in with adoptStorage.
+     */
     explicit Buffer(size_t initalSize = kInitialSize)
-        : buffer_(kCheapPrepend + initalSize),
-          readerIndex_(kCheapPrepend),
-          writerIndex_(kCheapPrepend)
+        : buffer_(initalSize ? kCheapPrepend + initalSize : 0),
+          readerIndex_(initalSize ? kCheapPrepend : 0),
+          writerIndex_(initalSize ? kCheapPrepend : 0)
     {
     }
 
+    void swap(Buffer &rhs)
+    {
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+    }
+
     size_t readableBytes() const { return writerIndex_ - readerIndex_; }
     size_t writableBytes() const { return buffer_.size() - writerIndex_; }
     size_t prependableBytes() const { return readerIndex_; }
 
     const char *peek() const { return begin() + readerIndex_; }
+
+    /**
+     * Search the readable bytes from `start` (default peek()) up to
+     * beginWrite(), returning a pointer to the first match or nullptr; no
+     * copy is made. Bytes and CRLF go through glibc's vectorized memchr,
+     * findSeq through an AVX2 or SSE2 kernel picked once from the CPU
+     * (MUDUO_BUFFER_FIND=sse2|scalar forces a lesser one, see
+     * findImplementation()).
+     */
+    const char *findCRLF() const { return findCRLF(peek()); }
+    const char *findCRLF(const char *start) const;
+    const char *findEOL() const { return findEOL(peek()); } // '\n'
+    const char *findEOL(const char *start) const { return findByte(start, '\n'); }
+    const char *findByte(char c) const { return findByte(peek(), c); }
+    const char *findByte(const char *start, char c) const;
+    const char *findSeq(const char *seq, size_t len) const { return findSeq(peek(), seq, len); }
+    const char *findSeq(const char *start, const char *seq, size_t len) const;
+    static const char *findImplementation(); // "avx2", "sse2" or "scalar"
+
     void retrieve(size_t len)
     {
         if (len < readableBytes())
@@ -36,10 +70,13 @@ public:
     }
     void retrieveAll()
     {
-        readerIndex_ = kCheapPrepend;
-        writerIndex_ = kCheapPrepend;
+        readerIndex_ = buffer_.empty() ? 0 : kCheapPrepend;
+        writerIndex_ = readerIndex_;
     }
 
+    // consume up to, not including, `end`, a pointer into the readable bytes
+    void retrieveUntil(const char *end) { retrieve(end - peek()); }
+
     std::string retrieveAllAsString() { return retrieveAsString(readableBytes()); }
     std::string retrieveAsString(size_t len)
     {
@@ -65,16 +102,147 @@ public:
     char *beginWrite() { return begin() + writerIndex_; }
     const char *beginWrite() const { return begin() + writerIndex_; }
 
+    /**
+     * Integers go over the wire in network (big-endian) byte order.
+     * peekIntN/readIntN require readableBytes() >= sizeof(intN_t).
+     */
+    void appendInt64(int64_t x)
+    {
+        uint64_t be = htobe64(static_cast<uint64_t>(x));
+        append(reinterpret_cast<const char *>(&be), sizeof be);
+    }
+    void appendInt32(int32_t x)
+    {
+        uint32_t be = htobe32(static_cast<uint32_t>(x));
+        append(reinterpret_cast<const char *>(&be), sizeof be);
+    }
+    void appendInt16(int16_t x)
+    {
+        uint16_t be = htobe16(static_cast<uint16_t>(x));
+        append(reinterpret_cast<const char *>(&be), sizeof be);
+    }
+    void appendInt8(int8_t x) { append(reinterpret_cast<const char *>(&x), sizeof x); }
+
+    int64_t peekInt64() const
+    {
+        uint64_t be;
+        ::memcpy(&be, peek(), sizeof be);
+        return static_cast<int64_t>(be64toh(be));
+    }
+    int32_t peekInt32() const
+    {
+        uint32_t be;
+        ::memcpy(&be, peek(), sizeof be);
+        return static_cast<int32_t>(be32toh(be));
+    }
+    int16_t peekInt16() const
+    {
+        uint16_t be;
+        ::memcpy(&be, peek(), sizeof be);
+        return static_cast<int16_t>(be16toh(be));
+    }
+    int8_t peekInt8() const { return static_cast<int8_t>(*peek()); }
+
+    int64_t readInt64()
+    {
+        int64_t x = peekInt64();
+        retrieve(sizeof x);
+        return x;
+    }
+    int32_t readInt32()
+    {
+        int32_t x = peekInt32();
+        retrieve(sizeof x);
+        return x;
+    }
+    int16_t readInt16()
+    {
+        int16_t x = peekInt16();
+        retrieve(sizeof x);
+        return x;
+    }
+    int8_t readInt8()
+    {
+        int8_t x = peekInt8();
+        retrieve(sizeof x);
+        return x;
+    }
+
+    /**
+     * Write in front of the readable bytes, into the kCheapPrepend area, so a
+     * length header costs no copy of the payload. len <= prependableBytes(),
+     * which is at least kCheapPrepend until something has been prepended.
+     */
+    void prepend(const void *data, size_t len)
+    {
+        if (buffer_.empty())
+        {
+            makeSpace(0);
+        }
+        readerIndex_ -= len;
+        ::memcpy(begin() + readerIndex_, data, len);
+    }
+    void prependInt64(int64_t x)
+    {
+        uint64_t be = htobe64(static_cast<uint64_t>(x));
+        prepend(&be, sizeof be);
+    }
+    void prependInt32(int32_t x)
+    {
+        uint32_t be = htobe32(static_cast<uint32_t>(x));
+        prepend(&be, sizeof be);
+    }
+    void prependInt16(int16_t x)
+    {
+        uint16_t be = htobe16(static_cast<uint16_t>(x));
+        prepend(&be, sizeof be);
+    }
+    void prependInt8(int8_t x) { prepend(&x, sizeof x); }
+
+    bool hasStorage() const { return !buffer_.empty(); }
+    size_t capacity() const { return buffer_.capacity(); }
+
+    /**
+     * Lend/return the underlying storage, used by BufferPool so idle
+     * connections hold no buffer memory. Only valid while readableBytes() == 0.
+     */
+    void adoptStorage(std::vector<char> &&storage)
+    {
+        buffer_.swap(storage);
+        retrieveAll();
+    }
+    std::vector<char> releaseStorage()
+    {
+        std::vector<char> storage;
+        storage.swap(buffer_);
+        retrieveAll();
+        return storage;
+    }
+
+    // drop excess capacity while keeping the readable bytes
+    void shrink(size_t reserve)
+    {
+        Buffer other(readableBytes() + reserve);
+        other.append(peek(), readableBytes());
+        swap(other);
+    }
+
     ssize_t readFd(int fd, int *saveErrno);
     ssize_t writeFd(int fd, int *saveErrno);
 
 private:
-    char *begin() { return &*buffer_.begin(); }
-    const char *begin() const { return &*buffer_.begin(); }
+    char *begin() { return buffer_.data(); }
+    const char *begin() const { return buffer_.data(); }
 
     void makeSpace(size_t len)
     {
-        if (writableBytes() + prependableBytes() < len + kCheapPrepend)
+        if (buffer_.empty())
+        {
+            buffer_.resize(kCheapPrepend + (len > kInitialSize ? len : kInitialSize));
+            readerIndex_ = kCheapPrepend;
+            writerIndex_ = kCheapPrepend;
+        }
+        else if (writableBytes() + prependableBytes() < len + kCheapPrepend)
         {
             buffer_.resize(writerIndex_ + len);
         }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include "noncopyable.h"
+
+/**
+ * Per-EventLoop recycling pool for Buffer storage, loop thread only.
+ *
+ * Storage is kept in power-of-two size classes from 1KB to 256KB. TcpConnection
+ * borrows it on the first read and gives it back whenever its input buffer
+ * drains, so connection churn does not hit the allocator and idle connections
+ * hold no buffer memory. A connection asks for the size its storage had when
+ * it last gave it back, so storage that grew for larger messages is reused by
+ * them. Storage that grew beyond the largest class is freed on return rather
+ * than cached, which is the shrink policy for connections that once received
+ * a large message.
+ */
+class BufferPool : noncopyable
+{
+public:
+    static const size_t kMinClassSize = 1024;
+    static const size_t kMaxClassSize = 256 * 1024;
+    static const size_t kMaxFreePerClass = 256;
+    static const size_t kMaxCachedBytes = 16 * 1024 * 1024;
+
+    BufferPool();
+
+    /**
+     * Storage for a buffer that needs about `size` bytes after
+     * Buffer::kCheapPrepend: a cached one of the class release() files such
+     * storage under, else of the next larger class that has one, else a new
+     * one of that class.
+     */
+    std::vector<char> acquire(size_t size = kMinClassSize);
+    void release(std::vector<char> &&storage);
+
+    // the actual size of the cached storage
+    size_t cachedBytes() const { return cachedBytes_; }
+
+private:
+    static const int kNumClasses = 9; // 1KB, 2KB, ... 256KB
+
+    // largest class whose size <= size, 0 below the smallest
+    static int classOf(size_t size);
+
+    std::vector<std::vector<char>> free_[kNumClasses];
+    size_t cachedBytes_;
+};
@@ -15,4 +15,10 @@ using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_
 
 using MessageCallback = std::function<void(const TcpConnectionPtr &,
                                            Buffer *,
-                                           Timestamp)>;
\ No newline at end of file
+                                           Timestamp)>;
+
+using TimerCallback = std::function<void()>;
+
+// used until the user sets their own: log the state change, discard the input
+void defaultConnectionCallback(const TcpConnectionPtr &conn);
+void defaultMessageCallback(const TcpConnectionPtr &conn, Buffer *buffer, Timestamp receiveTime);
@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "noncopyable.h"
 #include "Timestamp.h"
@@ -14,6 +15,21 @@ public:
     using EventCallback = std::function<void()>;
     using ReadEventCallback = std::function<void(Timestamp)>;
 
+    // the result of one recv or accept the Poller did on the channel's behalf
+    struct Completion
+    {
+        int res;          // bytes received or the accepted fd, -errno on failure
+        const char *data; // received bytes, valid until the next poll()
+    };
+    using CompletionCallback = std::function<void(const Completion *completions, size_t count, Timestamp)>;
+
+    enum CompletionMode
+    {
+        kReadiness,        // read interest is reported as readiness, the owner reads
+        kRecvCompletion,   // the Poller receives into its own buffers
+        kAcceptCompletion, // the Poller accepts connections
+    };
+
     Channel(EventLoop *loop, int fd);
     ~Channel();
 
@@ -26,8 +42,30 @@ public:
 
     void tie(const std::shared_ptr<void> &);
 
+    /**
+     * Completion mode, set before the first enable and only for loops whose
+     * supportsCompletions() is true: read interest makes the Poller keep a
+     * multishot recv or accept in flight, and everything it completed in one
+     * poll() is handed to cb in order instead of the read callback. Write
+     * interest is still reported as readiness.
+     */
+    void setCompletionMode(CompletionMode mode, CompletionCallback cb)
+    {
+        completionMode_ = mode;
+        completionCallback_ = std::move(cb);
+    }
+    CompletionMode completionMode() const { return completionMode_; }
+    void addCompletion(int res, const char *data)
+    {
+        Completion completion = {res, data};
+        completions_.push_back(completion);
+    }
+
     int fd() const { return fd_; }
     int events() const { return events_; }
+    // what the Poller registers: events_, or the fixed edge-triggered mask
+    int pollEvents() const { return edgeTriggered_ ? kEdgeEvents : events_; }
+    int revents() const { return revents_; }
     void set_revents(int revt) { revents_ = revt; }
 
     void enableReading()
@@ -35,6 +73,12 @@ public:
         events_ |= kReadEvent;
         update();
     }
+    // EPOLLEXCLUSIVE: one of the pollers sharing this fd is woken per event, set only once
+    void enableReadingExclusive()
+    {
+        events_ |= kExclusiveReadEvent;
+        update();
+    }
     void disableReading()
     {
         events_ &= ~kReadEvent;
@@ -56,6 +100,16 @@ public:
         update();
     }
 
+    /**
+     * Edge-triggered mode, set before the first enable: the fd is registered
+     * once for IN|OUT|RDHUP with EPOLLET and stays so until disableAll().
+     * enable/disableReading/Writing then only record interest without an
+     * epoll_ctl, and the owner has to read and write until EAGAIN.
+     * Only for loops whose supportsEdgeTriggered() is true.
+     */
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool isEdgeTriggered() const { return edgeTriggered_; }
+
     bool isNoneEvent() const { return events_ == kNoneEvent; }
     bool isWriting() const { return events_ & kWriteEvent; }
     bool isReading() const { return events_ & kReadEvent; }
@@ -75,12 +129,18 @@ private:
     static const int kNoneEvent;
     static const int kReadEvent;
     static const int kWriteEvent;
+    static const int kExclusiveReadEvent;
+    static const int kEdgeEvents;
 
     EventLoop *loop_;
     const int fd_;
     int events_;
     int revents_;
     int index_;
+    bool edgeTriggered_;
+    bool registered_; // the Poller has this channel with a non-empty mask
+    CompletionMode completionMode_;
+    std::vector<Completion> completions_; // filled by the Poller, consumed by handleEvent
 
     std::weak_ptr<void> tie_;
     bool tied_;
@@ -89,4 +149,5 @@ private:
     EventCallback writeCallback_;
     EventCallback closeCallback_;
     EventCallback errorCallback_;
+    CompletionCallback completionCallback_;
 };
\ No newline at end of file
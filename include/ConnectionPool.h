@@ -0,0 +1,117 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "InetAddress.h"
+#include "Timestamp.h"
+#include "TimerId.h"
+
+class EventLoop;
+class TcpClient;
+
+/**
+ * Persistent upstream connections of one EventLoop, keyed by address.
+ *
+ * Every connection lives on the pool's loop, so a borrower running on that
+ * loop uses it without any cross-thread hop; give each IO loop its own pool
+ * (e.g. from TcpServer's ThreadInitCallback). All methods must be called in
+ * the loop thread.
+ *
+ * acquire() hands out the most recently released idle connection, opens a
+ * new one while the upstream has fewer than maxTotal, and otherwise queues
+ * the caller until a connection is released or acquireTimeout passes (the
+ * callback then gets a null pointer). release() gives a connection back,
+ * once per acquire; it is closed instead if maxIdle connections are
+ * already idle. Idle
+ * connections are evicted when the peer closes them, when they receive
+ * unexpected data, or after idleTimeout seconds.
+ *
+ * A borrower installs its own message callback on the connection; the pool
+ * puts its idle handler back when the connection is released. Closing a
+ * borrowed connection instead of releasing it is fine, the pool notices.
+ */
+class ConnectionPool : noncopyable
+{
+public:
+    using AcquireCallback = std::function<void(const TcpConnectionPtr &)>;
+
+    ConnectionPool(EventLoop *loop, const std::string &name);
+    ~ConnectionPool();
+
+    // per upstream address, set before the first acquire()
+    void setMaxIdle(size_t maxIdle) { maxIdle_ = maxIdle; }
+    void setMaxTotal(size_t maxTotal) { maxTotal_ = maxTotal; }
+    void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+    void setAcquireTimeout(double seconds) { acquireTimeout_ = seconds; }
+
+    void acquire(const InetAddress &upstream, AcquireCallback cb);
+    void release(const TcpConnectionPtr &conn);
+
+    size_t idleCount(const InetAddress &upstream) const;
+    size_t totalCount(const InetAddress &upstream) const;
+
+private:
+    struct Waiter
+    {
+        uint64_t id;
+        AcquireCallback callback;
+        TimerId timer;
+    };
+
+    struct IdleConnection
+    {
+        TcpConnectionPtr conn;
+        Timestamp since;
+    };
+
+    struct Owner
+    {
+        std::string key;   // upstream
+        TcpClient *client;
+        bool borrowed;     // handed out and not released yet
+    };
+
+    struct Upstream
+    {
+        explicit Upstream(const InetAddress &address) : addr(address), total(0) {}
+
+        InetAddress addr;
+        std::deque<IdleConnection> idle; // most recently released at the back
+        std::deque<Waiter> waiters;      // oldest first
+        size_t total;                    // connecting + idle + borrowed
+    };
+
+    Upstream &upstream(const InetAddress &addr);
+    void openConnection(Upstream &up);
+    void onConnection(const std::string &key, TcpClient *client, const TcpConnectionPtr &conn);
+    void onIdleMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp);
+    void handOut(Upstream &up, const TcpConnectionPtr &conn);
+    void removeIdle(Upstream &up, const TcpConnectionPtr &conn);
+    void expireWaiter(const std::string &key, uint64_t id);
+    void evictIdle();
+
+    EventLoop *loop_;
+    const std::string name_;
+    size_t maxIdle_;
+    size_t maxTotal_;
+    double idleTimeout_;
+    double acquireTimeout_;
+    uint64_t nextWaiterId_;
+    int nextClientId_;
+    bool evicting_; // the idle sweep timer is running
+
+    std::unordered_map<std::string, Upstream> upstreams_; // keyed by ip:port
+    std::unordered_map<TcpClient *, std::unique_ptr<TcpClient>> clients_;
+    // which upstream and client a live connection belongs to
+    std::unordered_map<TcpConnection *, Owner> owners_;
+    TimerId evictTimer_;
+    // expires with the pool, releases still queued in the loop check it
+    std::shared_ptr<void> alive_;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <atomic>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "TimerId.h"
+
+class Channel;
+class EventLoop;
+
+/**
+ * Non-blocking active connect, the client-side counterpart of Acceptor.
+ *
+ * connect() returns EINPROGRESS and the socket is watched for writability;
+ * SO_ERROR then tells whether it worked. Failures, including a self-connect
+ * (local port == remote port on the same host), are retried with exponential
+ * backoff from kInitRetryDelayMs up to kMaxRetryDelayMs. On success the fd is
+ * handed to the NewConnectionCallback, which owns it from then on.
+ */
+class Connector : noncopyable, public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+
+    void start();   // any thread
+    void restart(); // loop thread only, resets the backoff
+    void stop();    // any thread
+
+    const InetAddress &serverAddress() const { return serverAddr_; }
+
+private:
+    enum StateE
+    {
+        kDisconnected,
+        kConnecting,
+        kConnected
+    };
+    static const int kMaxRetryDelayMs = 30 * 1000;
+    static const int kInitRetryDelayMs = 500;
+
+    void setState(StateE state) { state_ = state; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);
+    int removeAndResetChannel();
+    void resetChannel();
+
+    EventLoop *loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_;
+    StateE state_;
+    std::unique_ptr<Channel> channel_;
+    NewConnectionCallback newConnectionCallback_;
+    int retryDelayMs_;
+    TimerId retryTimer_;
+};
+
+using ConnectorPtr = std::shared_ptr<Connector>;
@@ -4,14 +4,21 @@
 #include <vector>
 #include <atomic>
 #include <memory>
-#include <mutex>
 
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+#include "MpscQueue.h"
+#include "LoopMetrics.h"
 
 class Channel;
 class Poller;
+class TimerQueue;
+class TimingWheel;
+class BlockPool;
+class BufferPool;
 
 class EventLoop : noncopyable
 {
@@ -26,11 +33,68 @@ public:
 
     Timestamp pollReturnTime() const { return pollReturnTime_; }
 
+    /**
+     * Busy-poll: for `microSeconds` after the last event or functor the loop
+     * polls with a zero timeout instead of sleeping, trading a spinning core
+     * for the scheduler wakeup latency. 0 (the default) always blocks.
+     */
+    void setBusyPoll(int microSeconds);
+
     void runInLoop(Functor cb);
     void queueInLoop(Functor cb);
 
     void wakeup();
 
+    /**
+     * Timers, safe to call from other threads.
+     * runAt runs cb at `time`, runAfter runs cb `delay` seconds later,
+     * runEvery runs cb every `interval` seconds.
+     */
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    TimerId runAfter(double delay, TimerCallback cb);
+    TimerId runEvery(double interval, TimerCallback cb);
+    void cancel(TimerId timerId);
+
+    // coarse timing wheel for idle timeouts, created on first use, loop thread only
+    TimingWheel *timingWheel();
+
+    // blocks for the SegmentedBuffers of connections on this loop, loop thread only
+    BlockPool *blockPool() { return blockPool_.get(); }
+    // storage for the input Buffers of connections on this loop, loop thread only
+    BufferPool *bufferPool() { return bufferPool_.get(); }
+
+    /**
+     * Load published for the pool's dispatch policies. The loop thread writes
+     * it with relaxed stores once per window (about 100ms, or per poll() when
+     * idle), any thread may read it without locking.
+     */
+    int activeConnections() const { return activeConnections_.load(std::memory_order_relaxed); }
+    int busyPermille() const { return busyPermille_.load(std::memory_order_relaxed); } // time not in poll()
+    int64_t bytesPerSecond() const { return bytesPerSecond_.load(std::memory_order_relaxed); }
+
+    // TcpConnection bookkeeping, any thread
+    void connectionAdded() { activeConnections_.fetch_add(1, std::memory_order_relaxed); }
+    void connectionRemoved() { activeConnections_.fetch_sub(1, std::memory_order_relaxed); }
+    // loop thread only
+    void addBytesRead(size_t n)
+    {
+        bytesInWindow_ += n;
+        metrics_.bytesRead.add(n);
+    }
+    void addBytesWritten(size_t n)
+    {
+        bytesInWindow_ += n;
+        metrics_.bytesWritten.add(n);
+    }
+
+    // written by the loop thread only, readable (snapshot()) from any thread
+    LoopMetrics &metrics() { return metrics_; }
+    const LoopMetrics &metrics() const { return metrics_; }
+
+    // immutable after construction, so any thread may ask
+    bool supportsEdgeTriggered() const;
+    bool supportsCompletions() const;
+
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
     bool hasChannel(Channel *channel);
@@ -39,7 +103,8 @@ public:
 
 private:
     void handleRead();
-    void doPendingFunctors();
+    size_t doPendingFunctors();
+    void updateLoad();
 
     using ChannelList = std::vector<Channel *>;
 
@@ -50,6 +115,10 @@ private:
 
     Timestamp pollReturnTime_;
     std::unique_ptr<Poller> poller_;
+    std::unique_ptr<TimerQueue> timerQueue_;
+    std::unique_ptr<TimingWheel> timingWheel_;
+    std::unique_ptr<BlockPool> blockPool_;
+    std::unique_ptr<BufferPool> bufferPool_;
 
     int wakeupFd_;
     std::unique_ptr<Channel> wakeupChannel_;
@@ -57,6 +126,21 @@ private:
     ChannelList activeChannels_;
 
     std::atomic_bool callingPendingFunctors_;
-    std::vector<Functor> pendingFunctors_;
-    std::mutex mutex_;
+    // set by the post that writes wakeupFd_, cleared by the loop before draining
+    std::atomic_bool wakeupPending_;
+    MpscQueue<Functor> pendingFunctors_; // lock-free, pushed from any thread
+
+    int64_t busyPollMicroSeconds_;
+    Timestamp lastActiveTime_; // poll return of the last iteration that did work
+
+    LoopMetrics metrics_;
+    Timestamp iterationEndTime_; // when the previous iteration went back to poll()
+
+    // accumulated by the loop thread, published by updateLoad()
+    Timestamp loadWindowStart_;
+    int64_t busyMicroSeconds_;
+    int64_t bytesInWindow_;
+    std::atomic_int activeConnections_;
+    std::atomic_int busyPermille_;
+    std::atomic<int64_t> bytesPerSecond_;
 };
\ No newline at end of file
@@ -19,10 +19,22 @@ public:
                     const std::string &name = std::string());
     ~EventLoopThread();
 
+    /**
+     * Pin the loop thread to `cpu` (before startLoop, -1 leaves it to the
+     * scheduler). The thread then prefers memory from that CPU's NUMA node, so
+     * the loop's pools and everything else it allocates stay local.
+     */
+    void setCpu(int cpu) { cpu_ = cpu; }
     EventLoop *startLoop();
 
+    // where the loop thread ended up, valid after startLoop, -1 if not pinned
+    int cpu() const { return cpu_; }
+    int numaNode() const { return numaNode_; }
+    const std::string &name() const { return thread_.name(); }
+
 private:
     void threadFunc();
+    void bindToCpu();
 
     EventLoop *loop_;
     bool exiting_;
@@ -30,4 +42,6 @@ private:
     std::mutex mutex_;
     std::condition_variable cond_;
     ThreadInitCallback callback_;
+    int cpu_;
+    int numaNode_;
 };
\ No newline at end of file
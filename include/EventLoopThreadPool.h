@@ -4,26 +4,70 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <stdint.h>
 
 #include "noncopyable.h"
+#include "LoopMetrics.h"
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 
 class EventLoopThreadPool
 {
 public:
     using ThreadInitCallback = std::function<void(EventLoop *)>;
+
+    /**
+     * How getLoopForPeer() picks the loop for a new connection.
+     * kRoundRobin: in turn, ignores load.
+     * kLeastConnections: the loop with the fewest live connections.
+     * kPowerOfTwoChoices: the less loaded of two random loops, by busy
+     *     ratio first, then bytes/sec, then connections.
+     * kPeerHash: by the peer's IP, so a client keeps hitting the same loop
+     *     and whatever it left in that thread's caches.
+     */
+    enum DispatchPolicy
+    {
+        kRoundRobin,
+        kLeastConnections,
+        kPowerOfTwoChoices,
+        kPeerHash,
+    };
+
     EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg);
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
 
+    /**
+     * CPU placement, set before start(). setCpuAffinity pins loop i to
+     * cpus[i % cpus.size()]; setAutoCpuAffinity gives each loop its own
+     * allowed CPU, skipping the one the base loop is running on.
+     */
+    void setCpuAffinity(const std::vector<int> &cpus) { cpus_ = cpus; }
+    void setAutoCpuAffinity(bool on) { autoCpuAffinity_ = on; }
+
+    struct LoopPlacement
+    {
+        std::string name;
+        int cpu;      // -1 when not pinned
+        int numaNode; // -1 when not pinned
+    };
+    // the layout chosen by start(), for logging
+    std::vector<LoopPlacement> layout() const;
+
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
     EventLoop *getNextLoop();
+    void setDispatchPolicy(DispatchPolicy policy) { policy_ = policy; }
+    // only call from the base loop, like getNextLoop()
+    EventLoop *getLoopForPeer(const InetAddress &peerAddr);
 
     std::vector<EventLoop *> getAllLoops();
 
+    // counters of the IO loops summed up, or of the base loop without threads
+    LoopMetrics::Snapshot metrics();
+
     bool started() const { return started_; }
     const std::string name() const { return name_; }
 
@@ -33,6 +77,10 @@ private:
     bool started_;
     int numThreads_;
     int next_;
+    DispatchPolicy policy_;
+    uint32_t randomState_; // xorshift state for kPowerOfTwoChoices
+    std::vector<int> cpus_;
+    bool autoCpuAffinity_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop *> loops_;
 };
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Timestamp.h"
+
+class Buffer;
+
+/**
+ * Resumable HTTP/1.x request parser, one per connection.
+ *
+ * parseRequest() consumes whatever part of the request is in the Buffer and
+ * remembers where it stopped: complete lines and body bytes are retrieved as
+ * soon as they are parsed, and the search for the end of an incomplete line
+ * resumes after the bytes already scanned. A request split over many reads
+ * is therefore scanned once in total, not once per read.
+ *
+ * Bodies are read by Content-Length or by Transfer-Encoding: chunked
+ * (chunk extensions and trailers are skipped). Once gotAll(), parsing stops
+ * until reset(), which leaves pipelined requests in the Buffer.
+ */
+class HttpContext
+{
+public:
+    enum ParseState
+    {
+        kExpectRequestLine,
+        kExpectHeaders,
+        kExpectBody,
+        kExpectChunkSize,
+        kExpectChunkData,
+        kExpectChunkEnd,
+        kExpectTrailers,
+        kGotAll,
+    };
+
+    static const size_t kMaxHeaderBytes = 64 * 1024; // request line plus headers
+
+    explicit HttpContext(size_t maxBodySize = 64 * 1024 * 1024)
+        : state_(kExpectRequestLine),
+          scanned_(0),
+          headerBytes_(0),
+          bodyRemaining_(0),
+          maxBodySize_(maxBodySize),
+          error_(HttpResponse::kUnknown)
+    {
+    }
+
+    // false on a malformed or oversized request, error() tells the status to answer with
+    bool parseRequest(Buffer *buf, Timestamp receiveTime);
+    bool gotAll() const { return state_ == kGotAll; }
+    HttpResponse::HttpStatusCode error() const { return error_; }
+
+    void reset()
+    {
+        state_ = kExpectRequestLine;
+        scanned_ = 0;
+        headerBytes_ = 0;
+        bodyRemaining_ = 0;
+        HttpRequest dummy;
+        request_.swap(dummy);
+    }
+
+    const HttpRequest &request() const { return request_; }
+    HttpRequest &request() { return request_; }
+
+private:
+    const char *findLine(Buffer *buf);
+    bool fail(HttpResponse::HttpStatusCode code)
+    {
+        error_ = code;
+        return false;
+    }
+    bool processRequestLine(const char *begin, const char *end);
+    bool processHeadersDone();
+    bool processChunkSize(const char *begin, const char *end);
+
+    ParseState state_;
+    HttpRequest request_;
+    size_t scanned_;       // readable bytes already searched for the end of the current line
+    size_t headerBytes_;   // request line and headers consumed so far
+    size_t bodyRemaining_; // of the Content-Length body or the current chunk
+    size_t maxBodySize_;
+    HttpResponse::HttpStatusCode error_;
+};
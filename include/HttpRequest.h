@@ -0,0 +1,155 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <strings.h>
+
+#include "Timestamp.h"
+
+/**
+ * One parsed HTTP/1.x request, filled in by HttpContext. Header names are
+ * matched case-insensitively.
+ */
+class HttpRequest
+{
+public:
+    enum Method
+    {
+        kInvalid,
+        kGet,
+        kPost,
+        kHead,
+        kPut,
+        kDelete,
+        kOptions,
+        kPatch
+    };
+    enum Version
+    {
+        kUnknown,
+        kHttp10,
+        kHttp11
+    };
+
+    struct CaseInsensitiveLess
+    {
+        bool operator()(const std::string &lhs, const std::string &rhs) const
+        {
+            return ::strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
+        }
+    };
+    using HeaderMap = std::map<std::string, std::string, CaseInsensitiveLess>;
+
+    HttpRequest()
+        : method_(kInvalid),
+          version_(kUnknown)
+    {
+    }
+
+    bool setMethod(const char *start, const char *end)
+    {
+        std::string m(start, end);
+        if (m == "GET")
+            method_ = kGet;
+        else if (m == "POST")
+            method_ = kPost;
+        else if (m == "HEAD")
+            method_ = kHead;
+        else if (m == "PUT")
+            method_ = kPut;
+        else if (m == "DELETE")
+            method_ = kDelete;
+        else if (m == "OPTIONS")
+            method_ = kOptions;
+        else if (m == "PATCH")
+            method_ = kPatch;
+        else
+            method_ = kInvalid;
+        return method_ != kInvalid;
+    }
+    Method method() const { return method_; }
+    const char *methodString() const
+    {
+        switch (method_)
+        {
+        case kGet:
+            return "GET";
+        case kPost:
+            return "POST";
+        case kHead:
+            return "HEAD";
+        case kPut:
+            return "PUT";
+        case kDelete:
+            return "DELETE";
+        case kOptions:
+            return "OPTIONS";
+        case kPatch:
+            return "PATCH";
+        default:
+            return "UNKNOWN";
+        }
+    }
+
+    void setVersion(Version v) { version_ = v; }
+    Version version() const { return version_; }
+
+    void setPath(const char *start, const char *end) { path_.assign(start, end); }
+    const std::string &path() const { return path_; }
+
+    void setQuery(const char *start, const char *end) { query_.assign(start, end); }
+    const std::string &query() const { return query_; }
+
+    void setReceiveTime(Timestamp t) { receiveTime_ = t; }
+    Timestamp receiveTime() const { return receiveTime_; }
+
+    // "Name: value" with optional whitespace around the value
+    void addHeader(const char *start, const char *colon, const char *end)
+    {
+        std::string field(start, colon);
+        ++colon;
+        while (colon < end && (*colon == ' ' || *colon == '\t'))
+        {
+            ++colon;
+        }
+        while (end > colon && (end[-1] == ' ' || end[-1] == '\t'))
+        {
+            --end;
+        }
+        std::string &value = headers_[field];
+        if (!value.empty())
+        {
+            value += ", "; // a repeated field is the same as one comma-separated list
+        }
+        value.append(colon, end);
+    }
+    std::string getHeader(const std::string &field) const
+    {
+        HeaderMap::const_iterator it = headers_.find(field);
+        return it == headers_.end() ? std::string() : it->second;
+    }
+    const HeaderMap &headers() const { return headers_; }
+
+    std::string &body() { return body_; }
+    const std::string &body() const { return body_; }
+
+    void swap(HttpRequest &that)
+    {
+        std::swap(method_, that.method_);
+        std::swap(version_, that.version_);
+        path_.swap(that.path_);
+        query_.swap(that.query_);
+        std::swap(receiveTime_, that.receiveTime_);
+        headers_.swap(that.headers_);
+        body_.swap(that.body_);
+    }
+
+private:
+    Method method_;
+    Version version_;
+    std::string path_;
+    std::string query_;
+    Timestamp receiveTime_;
+    HeaderMap headers_;
+    std::string body_;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+class Buffer;
+
+/**
+ * An HTTP/1.1 response, serialized by appendToBuffer() straight into the
+ * connection's output buffer: status line, headers and body are appended
+ * piece by piece, no string holding the whole response is built.
+ */
+class HttpResponse
+{
+public:
+    enum HttpStatusCode
+    {
+        kUnknown,
+        k200Ok = 200,
+        k204NoContent = 204,
+        k301MovedPermanently = 301,
+        k400BadRequest = 400,
+        k404NotFound = 404,
+        k413PayloadTooLarge = 413,
+        k431RequestHeaderFieldsTooLarge = 431,
+        k500InternalServerError = 500,
+        k501NotImplemented = 501,
+    };
+
+    explicit HttpResponse(bool close)
+        : statusCode_(kUnknown),
+          closeConnection_(close)
+    {
+    }
+
+    void setStatusCode(HttpStatusCode code) { statusCode_ = code; }
+    HttpStatusCode statusCode() const { return statusCode_; }
+    // defaults to the standard reason phrase of the status code
+    void setStatusMessage(const std::string &message) { statusMessage_ = message; }
+
+    void setCloseConnection(bool on) { closeConnection_ = on; }
+    bool closeConnection() const { return closeConnection_; }
+
+    void setContentType(const std::string &contentType) { addHeader("Content-Type", contentType); }
+    void addHeader(const std::string &key, const std::string &value) { headers_[key] = value; }
+
+    void setBody(const std::string &body) { body_ = body; }
+    void setBody(std::string &&body) { body_.swap(body); }
+    std::string &body() { return body_; }
+
+    // withBody == false for HEAD: same headers, Content-Length included, no body
+    void appendToBuffer(Buffer *output, bool withBody = true) const;
+
+private:
+    HttpStatusCode statusCode_;
+    std::string statusMessage_;
+    bool closeConnection_;
+    std::map<std::string, std::string> headers_;
+    std::string body_;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "noncopyable.h"
+#include "TcpServer.h"
+
+class HttpRequest;
+class HttpResponse;
+
+/**
+ * HTTP/1.1 on top of TcpServer: keep-alive, pipelining and chunked request
+ * bodies.
+ *
+ * Each connection carries an HttpContext that parses incrementally across
+ * reads. All requests that complete in one read are handed to the
+ * HttpCallback in order, their responses are serialized back to back into
+ * one buffer and sent with a single send(), so pipelined requests are
+ * answered in order with one write. The callback runs in the connection's
+ * IO thread and must fill in the response before returning.
+ */
+class HttpServer : noncopyable
+{
+public:
+    using HttpCallback = std::function<void(const HttpRequest &, HttpResponse *)>;
+
+    HttpServer(EventLoop *loop,
+               const InetAddress &listenAddr,
+               const std::string &name,
+               TcpServer::Option option = TcpServer::kNoReusePort);
+
+    EventLoop *getLoop() const { return loop_; }
+    // for the TcpServer options not repeated here (dispatch, edge-triggered, ...)
+    TcpServer &server() { return server_; }
+
+    // not thread safe, set before start(); the default answers 404
+    void setHttpCallback(const HttpCallback &cb) { httpCallback_ = cb; }
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    // larger bodies are answered with 413 and the connection is closed
+    void setMaxBodySize(size_t bytes) { maxBodySize_ = bytes; }
+
+    void start();
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    // appends the response to output, returns whether the connection closes after it
+    bool onRequest(const HttpRequest &req, Buffer *output);
+
+    EventLoop *loop_;
+    TcpServer server_;
+    HttpCallback httpCallback_;
+    size_t maxBodySize_;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Poller.h"
+#include "Timestamp.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+/**
+ * Poller backed by io_uring instead of epoll.
+ *
+ * Interest changes only queue SQEs; they are submitted together with the wait
+ * for completions in a single io_uring_enter per loop iteration. Polls are
+ * one-shot and re-armed at the start of the next poll(), after the Channel has
+ * handled its event, which keeps the level-triggered contract that Channel and
+ * TcpConnection rely on (a multishot poll would behave edge-triggered).
+ *
+ * Channels in completion mode skip the readiness step for reading: a multishot
+ * accept, or a multishot recv that picks buffers from a ring registered with
+ * the kernel, stays in flight and its results come back with the other
+ * completions of the same io_uring_enter. Received buffers go back to the ring
+ * at the start of the next poll(), once the Channel has consumed them.
+ *
+ * Every request carries (fd, operation, generation) as user_data, so
+ * completions that were in flight while a Channel was removed or modified
+ * are dropped.
+ */
+class IoUringPoller : public Poller
+{
+public:
+    IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+
+    // whether this kernel supports everything IoUringPoller needs
+    static bool isSupported();
+
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+    bool supportsCompletions() const override { return bufRing_ != nullptr; }
+
+private:
+    static const unsigned kRingEntries = 1024;
+    // provided buffers for multishot recv, per loop
+    static const unsigned kBufferCount = 256;
+    static const unsigned kBufferSize = 16 * 1024;
+    static const uint16_t kBufferGroup = 0;
+
+    struct Registration
+    {
+        Channel *channel;
+        uint64_t pollToken;  // user_data of the poll in flight
+        uint64_t opToken;    // user_data of the multishot recv or accept in flight
+        uint32_t pollEvents; // mask of the poll in flight
+        uint32_t generation; // numbers the requests made for this fd
+        bool pollArmed;      // a poll request is in flight in the kernel
+        bool opArmed;        // a multishot recv or accept is in flight
+        unsigned round;      // last poll() that reported the channel
+    };
+
+    Registration &registration(int fd);
+    void sync(int fd, Registration &reg);
+    void armPoll(int fd, Registration &reg, uint32_t events);
+    void disarmPoll(Registration &reg);
+    void armOp(int fd, Registration &reg);
+    void disarmOp(Registration &reg);
+    void report(Registration &reg, int revents, ChannelList *activeChannels);
+
+    bool setupBufferRing();
+    void recycleBuffers();
+
+    io_uring_sqe *getSqe();
+    int enter(unsigned toSubmit, unsigned minComplete, int timeoutMs);
+    void fillActiveChannels(ChannelList *activeChannels);
+
+    int ringfd_;
+
+    // submission queue ring
+    void *sqRing_;
+    size_t sqRingSize_;
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned *sqMask_;
+    unsigned *sqArray_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+    unsigned sqLocalTail_;
+    unsigned toSubmit_;
+
+    // completion queue ring, shares sqRing_ when IORING_FEAT_SINGLE_MMAP
+    void *cqRing_;
+    size_t cqRingSize_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned *cqMask_;
+    io_uring_cqe *cqes_;
+
+    // provided buffer ring, null when the kernel can't do completion mode
+    io_uring_buf_ring *bufRing_;
+    size_t bufRingSize_;
+    char *buffers_;
+    uint16_t bufLocalTail_;
+    std::vector<uint16_t> usedBuffers_; // handed out in the last poll()
+
+    unsigned round_;
+    std::vector<Registration> registrations_; // indexed by fd
+    std::vector<int> rearm_;                  // fds whose requests ended in the last poll()
+};
\ No newline at end of file
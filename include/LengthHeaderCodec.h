@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "Timestamp.h"
+
+class Buffer;
+
+/**
+ * Frames messages with a big-endian length header of 1, 2, 4 or 8 bytes.
+ *
+ * onMessage() is meant to be the connection's MessageCallback: it hands every
+ * complete frame to the FrameCallback as a pointer into the input Buffer, no
+ * copy is made and the bytes are only valid during the call. A header larger
+ * than maxFrameSize is treated as a protocol error and the connection is
+ * closed.
+ *
+ * send() writes the header into the Buffer's prependable area, so the payload
+ * is copied once into the output buffer and never moved to make room for it.
+ */
+class LengthHeaderCodec : noncopyable
+{
+public:
+    using FrameCallback = std::function<void(const TcpConnectionPtr &, const char *data, size_t len, Timestamp)>;
+
+    explicit LengthHeaderCodec(const FrameCallback &cb,
+                               size_t headerLen = 4,
+                               size_t maxFrameSize = 64 * 1024 * 1024);
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+    void send(const TcpConnectionPtr &conn, const char *data, size_t len) const;
+    void send(const TcpConnectionPtr &conn, const std::string &message) const
+    {
+        send(conn, message.data(), message.size());
+    }
+    // prepends the header to the readable bytes of buf and sends them, buf is left empty
+    void send(const TcpConnectionPtr &conn, Buffer *buf) const;
+
+    // prepends the header for the readable bytes of buf, returns false if they don't fit
+    bool encode(Buffer *buf) const;
+
+    size_t headerLen() const { return headerLen_; }
+    size_t maxFrameSize() const { return maxFrameSize_; }
+
+private:
+    uint64_t peekHeader(const Buffer *buf) const;
+
+    FrameCallback frameCallback_;
+    const size_t headerLen_;
+    const size_t maxFrameSize_;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+
+/**
+ * Append-only log file owned by the AsyncLogging backend thread, not thread safe.
+ * Rolls to a new file named basename.YYYYmmdd-HHMMSS.log once rollSize bytes
+ * have been written or a new day starts.
+ */
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string &basename, off_t rollSize);
+    ~LogFile();
+
+    void append(const char *logline, size_t len);
+    void flush();
+    void rollFile();
+
+private:
+    static const int kRollPerSeconds = 60 * 60 * 24;
+
+    const std::string basename_;
+    const off_t rollSize_;
+
+    FILE *fp_;
+    char buffer_[64 * 1024]; // stdio buffer, one write(2) per 64KB
+    off_t writtenBytes_;
+    time_t startOfPeriod_;
+    time_t lastRoll_;
+};
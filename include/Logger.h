@@ -1,61 +1,61 @@
 #pragma once
 
 #include <string>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "noncopyable.h"
 
-// LOG_INFO("%s %d", arg1, arg2)
-#define LOG_INFO(logmsgFormat, ...)                       \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(INFO);                         \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
-    } while (0)
+/**
+ * Levels below MUDUO_LOG_MIN_LEVEL are compiled out, levels below
+ * Logger::logLevel() are skipped at runtime. Either way a disabled
+ * statement costs one integer compare: no snprintf, no Logger::instance().
+ */
+#ifndef MUDUO_LOG_MIN_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_LOG_MIN_LEVEL DEBUG
+#else
+#define MUDUO_LOG_MIN_LEVEL INFO
+#endif
+#endif
 
-#define LOG_ERROR(logmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(ERROR);                        \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
+#define MUDUO_LOG_ENABLED(level) \
+    ((level) >= MUDUO_LOG_MIN_LEVEL && (level) >= Logger::logLevel())
+
+#define MUDUO_LOG(level, logmsgFormat, ...)                              \
+    do                                                                   \
+    {                                                                    \
+        if (MUDUO_LOG_ENABLED(level))                                    \
+        {                                                                \
+            char buf[1024];                                              \
+            Logger::instance().log(level, buf,                           \
+                snprintf(buf, sizeof buf, logmsgFormat, ##__VA_ARGS__)); \
+        }                                                                \
     } while (0)
 
+// LOG_INFO("%s %d", arg1, arg2)
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG(INFO, logmsgFormat, ##__VA_ARGS__)
+
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG(ERROR, logmsgFormat, ##__VA_ARGS__)
+
 #define LOG_FATAL(logmsgFormat, ...)                      \
     do                                                    \
     {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(FATAL);                        \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
+        char buf[1024];                                   \
+        Logger::instance().log(FATAL, buf,                \
+            snprintf(buf, sizeof buf, logmsgFormat, ##__VA_ARGS__)); \
         exit(-1);                                         \
     } while (0)
 
-#ifdef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instance();              \
-        logger.setLogLevel(DEBUG);                        \
-        char buf[1024] = {0};                             \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
-    } while (0)
-#else
-#define LOG_DEBUG(logmsgFormat, ...)
-#endif
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG(DEBUG, logmsgFormat, ##__VA_ARGS__)
 
+// ordered by severity so a single compare decides whether a level is enabled
 enum LogLevel
 {
+    DEBUG, // debuf info
     INFO,  // general info
     ERROR, // error info
     FATAL, // core dump info
-    DEBUG, // debuf info
 };
 
 // output a log class
@@ -63,13 +63,23 @@ enum LogLevel
 class Logger : noncopyable
 {
 public:
+    // where formatted lines go, stdout by default, see AsyncLogging
+    using OutputFunc = void (*)(const char *msg, size_t len);
+    using FlushFunc = void (*)();
+
     // fetch the only instance object of the log singleton
     static Logger &instance();
-    // set log level
-    void setLogLevel(int level);
+
+    // runtime threshold, messages below it are dropped before formatting
+    static int logLevel() { return logLevel_; }
+    static void setLogLevel(int level) { logLevel_ = level; }
+
+    static void setOutput(OutputFunc out);
+    static void setFlush(FlushFunc flush);
+
     // write log
-    void log(std::string msg);
+    void log(int level, const char *msg, int len);
 
 private:
-    int logLevel_;
-};
\ No newline at end of file
+    static int logLevel_;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+#include "noncopyable.h"
+
+/**
+ * Runtime counters of one EventLoop.
+ *
+ * Only the loop thread writes them, with a relaxed load and store instead of
+ * a locked read-modify-write, which compiles to plain moves. Any thread may
+ * read them, so snapshot() works on a running loop without a round trip.
+ */
+class LoopMetrics : noncopyable
+{
+public:
+    // single-writer counter
+    class Counter
+    {
+    public:
+        Counter() : value_(0) {}
+        void add(uint64_t n) { value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+        uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> value_;
+    };
+
+    // bucket i holds values in [2^(i-1), 2^i), bucket 0 holds 0
+    static const int kNumBuckets = 40;
+
+    class Histogram
+    {
+    public:
+        void record(uint64_t value)
+        {
+            int bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+            buckets_[bucket < kNumBuckets ? bucket : kNumBuckets - 1].add(1);
+        }
+        uint64_t bucket(int i) const { return buckets_[i].value(); }
+
+    private:
+        Counter buckets_[kNumBuckets];
+    };
+
+    // plain copy of the counters, can be summed over loops
+    struct Snapshot
+    {
+        Snapshot();
+
+        Snapshot &operator+=(const Snapshot &rhs);
+
+        // upper bound of the bucket holding the q-th quantile (0 < q <= 1)
+        static uint64_t percentile(const uint64_t (&buckets)[kNumBuckets], double q);
+
+        std::string toString() const;
+
+        uint64_t iterations;
+        uint64_t functorsRun;
+        uint64_t bytesRead;
+        uint64_t bytesWritten;
+        uint64_t connectionsOpened;
+        uint64_t connectionsClosed;
+        uint64_t pollWaitUs[kNumBuckets];       // time blocked in poll()
+        uint64_t processingUs[kNumBuckets];     // time from poll() return to the next poll()
+        uint64_t activeChannels[kNumBuckets];   // channels per poll() return
+        uint64_t pendingFunctors[kNumBuckets];  // functors per drain, i.e. queue depth
+    };
+
+    Snapshot snapshot() const;
+
+    Counter iterations;
+    Counter functorsRun;
+    Counter bytesRead;
+    Counter bytesWritten;
+    Counter connectionsOpened;
+    Counter connectionsClosed;
+    Histogram pollWaitUs;
+    Histogram processingUs;
+    Histogram activeChannels;
+    Histogram pendingFunctors;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+
+#include "noncopyable.h"
+
+/**
+ * Unbounded lock-free multi-producer single-consumer queue
+ * (Vyukov's intrusive node queue).
+ *
+ * push() is wait-free: one exchange plus one store, and it may be called from
+ * any thread. drain() may only be called from the single consumer thread.
+ * Items from one producer come out in the order that producer pushed them.
+ */
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    MpscQueue()
+        : head_(new Node),
+          tail_(head_.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~MpscQueue()
+    {
+        while (tail_)
+        {
+            Node *next = tail_->next.load(std::memory_order_relaxed);
+            delete tail_;
+            tail_ = next;
+        }
+    }
+
+    void push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        // between the exchange and this store the consumer sees the queue end at prev
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * Run f on every item that was in the queue when drain() started,
+     * items pushed meanwhile (including by f itself) are left for the next call.
+     * A producer that is still between its exchange and store also ends the
+     * batch early; it will wake the consumer again once it is done.
+     */
+    template <typename Func>
+    size_t drain(Func f)
+    {
+        Node *last = head_.load(std::memory_order_acquire);
+        size_t count = 0;
+        while (tail_ != last)
+        {
+            Node *next = tail_->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                break;
+            }
+            delete tail_;
+            tail_ = next;
+            T value(std::move(next->value));
+            ++count;
+            f(value);
+        }
+        return count;
+    }
+
+    // only meaningful on the consumer thread
+    bool empty() const
+    {
+        return tail_->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        Node() : next(nullptr) {}
+        explicit Node(T &&v) : value(std::move(v)), next(nullptr) {}
+
+        T value;
+        std::atomic<Node *> next;
+    };
+
+    std::atomic<Node *> head_; // producers push here
+    // keep the consumer's tail_ off the cache line the producers keep bouncing
+    char pad_[64 - sizeof(std::atomic<Node *>)];
+    Node *tail_; // consumer-owned stub, its successor is the front
+};
@@ -20,6 +20,11 @@ public:
     virtual void updateChannel(Channel *channel) = 0;
     virtual void removeChannel(Channel *channel) = 0;
 
+    // whether Channel::setEdgeTriggered is honoured
+    virtual bool supportsEdgeTriggered() const { return false; }
+    // whether Channel::setCompletionMode is honoured
+    virtual bool supportsCompletions() const { return false; }
+
     bool hasChannel(Channel *channel) const;
 
     static Poller *newDefaultPoller(EventLoop *loop);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <memory>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+#include "BlockPool.h"
+
+/**
+ * Output buffer made of a chain of fixed-size blocks.
+ *
+ * append() only ever copies into the tail block or a new one, existing data is
+ * never moved or reallocated, so a large queued response followed by small
+ * writes stays cheap. writeFd() flushes up to IOV_MAX blocks with one writev.
+ *
+ * peek()/retrieve()/readableBytes() behave like Buffer's; peek() has to
+ * linearize the chain into one block when data spans several, so hot paths
+ * should avoid it.
+ *
+ * appendPinned() queues caller-owned memory without copying, kept alive by the
+ * `pin` handle. Such a block is written alone with sendmsg(MSG_ZEROCOPY) and
+ * its pin is handed back to the caller, which must hold it until the kernel
+ * reports the transmission complete.
+ */
+class SegmentedBuffer : noncopyable
+{
+public:
+    // blocks come from pool, or from the heap when pool is nullptr
+    explicit SegmentedBuffer(BlockPool *pool = nullptr);
+    ~SegmentedBuffer();
+
+    size_t readableBytes() const { return readable_; }
+    size_t numBlocks() const { return blocks_.size(); }
+
+    void append(const char *data, size_t len);
+    void appendPinned(const char *data, size_t len, const std::shared_ptr<const void> &pin);
+
+    const char *peek();
+    void retrieve(size_t len);
+    void retrieveAll();
+    std::string retrieveAllAsString();
+
+    void swap(SegmentedBuffer &rhs);
+
+    // *zeroCopyPin is set when the write went out with MSG_ZEROCOPY
+    ssize_t writeFd(int fd, int *saveErrno, std::shared_ptr<const void> *zeroCopyPin = nullptr);
+
+private:
+    struct Block
+    {
+        char *data;
+        size_t capacity;
+        size_t readerIndex;
+        size_t writerIndex;
+        std::shared_ptr<const void> pin; // set for caller-owned memory
+    };
+
+    Block newBlock(size_t capacity);
+    void freeBlock(const Block &block);
+
+    std::deque<Block> blocks_;
+    size_t readable_;
+    BlockPool *pool_;
+};
@@ -24,6 +24,8 @@ public:
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
+    bool setZeroCopy(bool on); // false if the kernel lacks SO_ZEROCOPY
+    bool setBusyPoll(int microSeconds); // false without CAP_NET_ADMIN or kernel support
 
 private:
     const int sockfd_;
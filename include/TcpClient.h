@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <atomic>
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "Connector.h"
+#include "TcpConnection.h"
+
+class EventLoop;
+
+/**
+ * One outgoing connection on `loop`, delivered as the same TcpConnection
+ * and callbacks TcpServer uses. With enableRetry() a closed connection is
+ * re-established through the Connector's backoff.
+ */
+class TcpClient : noncopyable
+{
+public:
+    TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg);
+    ~TcpClient();
+
+    void connect();
+    void disconnect(); // shutdown the write side of the current connection
+    void stop();       // give up connecting
+
+    TcpConnectionPtr connection() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop *getLoop() const { return loop_; }
+    bool retry() const { return retry_; }
+    void enableRetry() { retry_ = true; }
+    const std::string &name() const { return name_; }
+
+    // not thread safe, set before connect()
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+
+private:
+    void newConnection(int sockfd);
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    EventLoop *loop_;
+    ConnectorPtr connector_;
+    const std::string name_;
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    int nextConnId_; // loop thread only
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_; // guarded by mutex_
+};
@@ -3,14 +3,18 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <deque>
+#include <sys/types.h>
 
 #include "noncopyable.h"
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "Channel.h"
+#include "SegmentedBuffer.h"
 #include "Timestamp.h"
+#include "TimingWheel.h"
 
-class Channel;
 class EventLoop;
 class Socket;
 
@@ -39,10 +43,47 @@ public:
     const InetAddress &peerAddress() const { return peerAddr_; }
     bool connected() const { return state_ == kConnected; }
 
+    /**
+     * Thread safe. In the loop thread the bytes are written or buffered right away
+     * without allocating; from other threads the message is handed over by move
+     * (string&&, Buffer*) or copied once (const string&, const void*).
+     */
     void send(const std::string &buf);
-    void sendFile(int fd, off_t *offset, size_t count);
+    void send(std::string &&buf);
+    void send(const void *data, size_t len);
+    void send(Buffer *buf); // takes the readable bytes, buf is left empty
+
+    /**
+     * Send caller-owned memory with MSG_ZEROCOPY when it is at least the
+     * zero-copy threshold, otherwise like send(data, len). `pin` keeps the
+     * memory alive until the kernel reports the transmission done; the memory
+     * must not be modified before the pin is released.
+     */
+    void sendZeroCopy(const void *data, size_t len, const std::shared_ptr<const void> &pin);
+    void sendZeroCopy(const std::shared_ptr<const std::string> &message);
+
+    // 0 disables zero-copy sends, call from the connection callback
+    void setZeroCopyThreshold(size_t bytes);
+    /**
+     * Send `count` bytes of file `fd` starting at `offset` with sendfile(2),
+     * ordered after everything sent before it. The caller keeps fd open
+     * until the write complete callback fires.
+     */
+    void sendFile(int fd, off_t offset, size_t count);
 
     void shutdown(); // close write
+    void forceClose();
+
+    /**
+     * Close the connection after `seconds` without reads or writes,
+     * seconds <= 0 disables it. Enforced by the loop's TimingWheel,
+     * so it fires within one wheel tick of the deadline.
+     */
+    void setIdleTimeout(double seconds);
+
+    // per-connection state of the protocol on top, e.g. a parser; loop thread only
+    void setContext(const std::shared_ptr<void> &context) { context_ = context; }
+    const std::shared_ptr<void> &getContext() const { return context_; }
 
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
@@ -54,6 +95,17 @@ public:
     }
     void setCloseCallback(const CloseCallback &cb) { closeCallback_ = cb; }
 
+    /**
+     * Register the socket edge-triggered (see Channel::setEdgeTriggered):
+     * no epoll_ctl when the output buffer fills or drains, reads and writes
+     * go on until the socket is drained or full. Call before
+     * connectEstablished; ignored if the loop's poller can't do it.
+     */
+    void setEdgeTriggered(bool on);
+
+    // kernel-side busy polling on the socket, see Socket::setBusyPoll
+    bool setSocketBusyPoll(int microSeconds);
+
     void connectEstablished(); // called when TcpServer accepts a new connection
     void connectDestroyed();   // called when TcpServer has removed me from its map
 private:
@@ -67,13 +119,27 @@ private:
     void setState(StateE s) { state_ = s; }
 
     void handleRead(Timestamp receiveTime);
+    void handleReceived(const Channel::Completion *received, size_t count, Timestamp receiveTime);
+    void releaseInputBuffer();
     void handleWrite();
     void handleClose();
     void handleError();
 
     void sendInLoop(const void *data, size_t len);
+    void sendStringInLoop(const std::string &message);
+    void sendBufferInLoop(const std::shared_ptr<Buffer> &message);
+    void sendZeroCopyInLoop(const void *data, size_t len, const std::shared_ptr<const void> &pin);
+    void setZeroCopyThresholdInLoop(size_t bytes);
+    using ZeroCopyPins = std::deque<std::pair<uint32_t, std::shared_ptr<const void>>>;
+    struct ZeroCopyLinger;
+    static void readZeroCopyCompletions(int fd, const std::string &name, ZeroCopyPins *inflight);
+    static void lingerZeroCopy(EventLoop *loop, const std::shared_ptr<ZeroCopyLinger> &linger, int checksLeft);
     void shutdownInLoop();
-    void sendFileInLoop(int fd, off_t *offset, size_t count);
+    void forceCloseInLoop();
+    void setIdleTimeoutInLoop(double seconds);
+    void handleIdleTimeout();
+    void sendFileInLoop(int fd, off_t offset, size_t count);
+    bool writePendingFile(int *savedErrno);
 
 private:
     EventLoop *loop_;
@@ -99,6 +165,40 @@ private:
     CloseCallback closeCallback_;
     size_t highWaterMark_;
 
-    Buffer inputBuffer_;  // receive data
-    Buffer outputBuffer_; // send data
+    double idleTimeout_;
+    TimingWheel::Node idleNode_;
+
+    std::shared_ptr<void> context_;
+
+    /**
+     * A file region queued behind outputBuffer_. Data sent after the file is
+     * kept in its `trailing` buffer, which becomes outputBuffer_ once the file
+     * has been written, so bytes always reach the peer in send order.
+     */
+    struct PendingFile
+    {
+        PendingFile(int fdArg, off_t offsetArg, size_t remainingArg, BlockPool *pool)
+            : fd(fdArg), offset(offsetArg), remaining(remainingArg), trailing(pool)
+        {
+        }
+
+        int fd;
+        off_t offset;
+        size_t remaining;
+        SegmentedBuffer trailing;
+    };
+
+    Buffer inputBuffer_;           // receive data, storage borrowed from the loop's BufferPool
+    size_t inputSizeHint_;         // size of that storage when it was last given back
+    SegmentedBuffer outputBuffer_; // send data, never moved once queued, flushed with writev
+    std::deque<PendingFile> pendingFiles_;
+
+    /**
+     * MSG_ZEROCOPY state: every successful zero-copy send gets the next
+     * sequence number from the kernel, the pin stays here until that number
+     * is reported on the error queue (EPOLLERR).
+     */
+    size_t zeroCopyThreshold_;
+    uint32_t zeroCopyNextSeq_;
+    ZeroCopyPins zeroCopyInflight_;
 };
\ No newline at end of file
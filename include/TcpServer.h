@@ -4,6 +4,8 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <mutex>
+#include <vector>
 #include <unordered_map>
 
 #include "EventLoop.h"
@@ -20,27 +22,68 @@ class TcpServer
 public:
     using ThreadInitCallback = std::function<void(EventLoop *)>;
 
+    /**
+     * kNoReusePort/kReusePort: one Acceptor in the base loop hands every
+     * connection to a sub loop, SO_REUSEPORT only lets other processes bind too.
+     * kReusePortPerLoop: every IO loop owns a listening socket in one
+     * SO_REUSEPORT group, the kernel spreads connections by hash and each is
+     * accepted and served by the same thread.
+     * kSharedListenFd: every IO loop waits on one listening socket with
+     * EPOLLEXCLUSIVE, an idle loop picks up the connection.
+     * In the per-loop modes the thread pool decides nothing; the listen address
+     * is bound in start().
+     */
     enum Option
     {
         kNoReusePort,
         kReusePort,
+        kReusePortPerLoop,
+        kSharedListenFd,
     };
 
     TcpServer(EventLoop *loop, const InetAddress &listenAddr,
               const std::string &nameArg, Option option = kNoReusePort);
     ~TcpServer();
 
+    const std::string &ipPort() const { return ipPort_; }
+    const std::string &name() const { return name_; }
+    EventLoop *getLoop() const { return loop_; }
+
     void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
 
     void setThreadNum(int numThreads);
+    // register connections edge-triggered, see TcpConnection::setEdgeTriggered
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    /**
+     * Busy-poll every IO loop for spinMicroSeconds after activity (see
+     * EventLoop::setBusyPoll), and optionally set SO_BUSY_POLL on accepted
+     * sockets. Call before start().
+     */
+    void setBusyPoll(int spinMicroSeconds, int socketBusyPollMicroSeconds = 0)
+    {
+        busyPollMicroSeconds_ = spinMicroSeconds;
+        socketBusyPollMicroSeconds_ = socketBusyPollMicroSeconds;
+    }
+    // e.g. for CPU placement before start(), or to log threadPool()->layout() after
+    std::shared_ptr<EventLoopThreadPool> threadPool() { return threadPool_; }
+    // runtime counters of all IO loops, safe from any thread
+    LoopMetrics::Snapshot metrics() { return threadPool_->metrics(); }
+    // only used when the base loop accepts, see Option
+    void setDispatchPolicy(EventLoopThreadPool::DispatchPolicy policy) { threadPool_->setDispatchPolicy(policy); }
+    // see Acceptor::setMaxAcceptsPerRead, call before start()
+    void setMaxAcceptsPerRead(int n);
 
     void start();
 
 private:
     void newConnection(int sockfd, const InetAddress &peerAddr);
+    void newConnectionInLoop(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    void startLoopAcceptors();
+    void establishPendingConnections();
+    bool acceptorPerLoop() const { return option_ == kReusePortPerLoop || option_ == kSharedListenFd; }
     void removeConnection(const TcpConnectionPtr &conn);
     void removeConnectionInLoop(const TcpConnectionPtr &conn);
 
@@ -51,9 +94,12 @@ private:
 
     const std::string ipPort_;
     const std::string name_;
+    const InetAddress listenAddr_;
+    const Option option_;
 
-    // run in mainLoop to listen connectionEvent
+    // run in mainLoop to listen connectionEvent, null in the per-loop modes
     std::unique_ptr<Acceptor> acceptor_;
+    std::vector<std::unique_ptr<Acceptor>> loopAcceptors_; // one per IO loop
 
     std::shared_ptr<EventLoopThreadPool> threadPool_; // one loop per threa
 
@@ -63,7 +109,14 @@ private:
 
     ThreadInitCallback threadInitCallback_; // Callback for loop thread initialization
     int numThreads_;
+    bool edgeTriggered_;
+    int busyPollMicroSeconds_;
+    int socketBusyPollMicroSeconds_;
+    int maxAcceptsPerRead_;
     std::atomic_int started_;
+    std::mutex mutex_; // per-loop acceptors add and remove from their own threads
     int nextConnId_;
     ConnectionMap connections_;
+    // accepted by the base loop in the current batch, not yet handed to their loop
+    std::vector<TcpConnectionPtr> pendingConnections_;
 };
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+class Timer;
+
+/**
+ * An opaque identifier returned by EventLoop::runAt/runAfter/runEvery,
+ * used to cancel the timer. The sequence number tells apart two timers
+ * that happen to be allocated at the same address.
+ */
+class TimerId
+{
+public:
+    TimerId()
+        : timer_(nullptr),
+          sequence_(0)
+    {
+    }
+
+    TimerId(Timer *timer, int64_t seq)
+        : timer_(timer),
+          sequence_(seq)
+    {
+    }
+
+    friend class TimerQueue;
+
+private:
+    Timer *timer_;
+    int64_t sequence_;
+};
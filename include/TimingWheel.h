@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+#include "noncopyable.h"
+#include "TimerId.h"
+
+class EventLoop;
+
+/**
+ * Hashed timing wheel for coarse per-connection timeouts (e.g. idle eviction),
+ * owned by an EventLoop and only touched from that loop's thread.
+ *
+ * Every Node sits in the bucket of its expiration tick. Refreshing a node only
+ * records the current tick (one store, no relinking); the real deadline is
+ * recomputed when its bucket comes round, and the node is either moved to the
+ * bucket of its new deadline or expired. Timeouts longer than one revolution
+ * simply stay in their bucket until their absolute tick is reached.
+ */
+class TimingWheel : noncopyable
+{
+public:
+    using TimeoutCallback = std::function<void()>;
+
+    class Node : noncopyable
+    {
+    public:
+        Node()
+            : prev_(nullptr),
+              next_(nullptr),
+              wheel_(nullptr),
+              timeoutTicks_(0),
+              lastActiveTick_(0),
+              expireTick_(0)
+        {
+        }
+        ~Node();
+
+        bool linked() const { return wheel_ != nullptr; }
+        // O(1), called on every read/write of the owner
+        void touch();
+
+    private:
+        friend class TimingWheel;
+
+        Node *prev_;
+        Node *next_;
+        TimingWheel *wheel_;
+        int64_t timeoutTicks_;
+        int64_t lastActiveTick_;
+        int64_t expireTick_;
+        TimeoutCallback callback_;
+    };
+
+    static const int kDefaultBuckets = 512;
+
+    TimingWheel(EventLoop *loop, double tickSeconds, int numBuckets = kDefaultBuckets);
+    ~TimingWheel();
+
+    // (re)arm node to fire cb after `timeout` seconds without touch()
+    void add(Node *node, double timeout, TimeoutCallback cb);
+    void remove(Node *node);
+
+    int64_t currentTick() const { return currentTick_; }
+    size_t size() const { return size_; }
+    double tickSeconds() const { return tickSeconds_; }
+
+private:
+    void onTick();
+    void link(Node *node, int64_t expireTick);
+    void unlink(Node *node);
+
+    EventLoop *loop_;
+    const double tickSeconds_;
+    const int64_t mask_;
+    std::vector<Node *> buckets_; // heads of intrusive doubly linked lists
+    int64_t currentTick_;
+    size_t size_;
+
+    bool ticking_;
+    TimerId tickTimer_;
+};
+
+inline void TimingWheel::Node::touch()
+{
+    if (wheel_)
+    {
+        lastActiveTick_ = wheel_->currentTick_;
+    }
+}
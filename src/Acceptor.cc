@@ -1,9 +1,12 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "Acceptor.h"
+#include "EventLoop.h"
 #include "Logger.h"
 #include "InetAddress.h"
 
@@ -21,48 +24,160 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
     : loop_(loop),
       acceptSocket_(createNonblocking()),
       acceptChannel_(loop, acceptSocket_.fd()),
-      listenning_(false)
+      listenning_(false),
+      exclusive_(false),
+      maxAcceptsPerRead_(kDefaultMaxAcceptsPerRead),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
     acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(true);
+    acceptSocket_.setReusePort(reuseport);
     acceptSocket_.bindAddress(listenAddr);
     acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
 }
 
+Acceptor::Acceptor(EventLoop *loop, int sockfd)
+    : loop_(loop),
+      acceptSocket_(sockfd),
+      acceptChannel_(loop, sockfd),
+      listenning_(false),
+      exclusive_(true),
+      maxAcceptsPerRead_(kDefaultMaxAcceptsPerRead),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+{
+    if (sockfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d shared listen socket err:%d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
+}
+
 Acceptor::~Acceptor()
 {
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    ::close(idleFd_);
 }
 
 void Acceptor::listen()
 {
     listenning_ = true;
-    acceptSocket_.listen();
-    acceptChannel_.enableReading();
+    acceptSocket_.listen(); // harmless again on a shared socket
+    if (loop_->supportsCompletions())
+    {
+        acceptChannel_.setCompletionMode(Channel::kAcceptCompletion,
+                                         std::bind(&Acceptor::handleAccepted, this,
+                                                   std::placeholders::_1, std::placeholders::_2));
+    }
+    if (exclusive_)
+    {
+        acceptChannel_.enableReadingExclusive();
+    }
+    else
+    {
+        acceptChannel_.enableReading();
+    }
 }
 
+/**
+ * Accept until EAGAIN or maxAcceptsPerRead_, so a reconnect storm costs one
+ * poll() per batch instead of one per connection.
+ */
 void Acceptor::handleRead()
 {
-    InetAddress peerAddress;
-    int connfd = acceptSocket_.accept(&peerAddress);
-    if (connfd >= 0)
+    int accepted = 0;
+    for (int i = 0; i < maxAcceptsPerRead_; ++i)
     {
+        InetAddress peerAddress;
+        int connfd = acceptSocket_.accept(&peerAddress);
+        if (connfd >= 0)
+        {
+            ++accepted;
+            if (NewConnectionCallback_)
+            {
+                NewConnectionCallback_(connfd, peerAddress);
+            }
+            else
+            {
+                ::close(connfd);
+            }
+            continue;
+        }
+        int savedErrno = errno;
+        // EAGAIN: drained, or another loop sharing the socket took the connection first
+        if (savedErrno == EAGAIN)
+        {
+            break;
+        }
+        LOG_ERROR("%s:%s:%d accept err:%d\n", __FILE__, __FUNCTION__, __LINE__, savedErrno);
+        if (savedErrno == EMFILE || savedErrno == ENFILE)
+        {
+            dropConnection();
+        }
+        else if (savedErrno != ECONNABORTED && savedErrno != EINTR && savedErrno != EPROTO)
+        {
+            // e.g. ENOBUFS/ENOMEM: retry on the next poll() rather than spin here
+            break;
+        }
+    }
+    if (accepted > 0 && acceptBatchCallback_)
+    {
+        acceptBatchCallback_();
+    }
+}
+
+/**
+ * Completion mode: the poller's multishot accept already took the
+ * connections, everything it accepted in one poll() arrives here at once.
+ */
+void Acceptor::handleAccepted(const Channel::Completion *accepted, size_t count)
+{
+    int established = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        int connfd = accepted[i].res;
+        if (connfd < 0)
+        {
+            LOG_ERROR("%s:%s:%d accept err:%d\n", __FILE__, __FUNCTION__, __LINE__, -connfd);
+            if (connfd == -EMFILE || connfd == -ENFILE)
+            {
+                dropConnection();
+            }
+            continue;
+        }
+        sockaddr_in addr;
+        socklen_t len = sizeof addr;
+        ::memset(&addr, 0, sizeof addr);
+        ::getpeername(connfd, reinterpret_cast<sockaddr *>(&addr), &len);
+        ++established;
         if (NewConnectionCallback_)
         {
-            NewConnectionCallback_(connfd, peerAddress);
+            NewConnectionCallback_(connfd, InetAddress(addr));
         }
         else
         {
             ::close(connfd);
         }
     }
-    else
+    if (established > 0 && acceptBatchCallback_)
     {
-        LOG_ERROR("%s:%s:%d accept err:%d\n", __FILE__, __FUNCTION__, __LINE__, errno);
-        if (errno == EMFILE)
-        {
-            LOG_ERROR("%s:%s:%d sockfd reached limit\n", __FILE__, __FUNCTION__, __LINE__);
-        }
+        acceptBatchCallback_();
+    }
+}
+
+/**
+ * Out of descriptors: the pending connection keeps the listening socket
+ * readable, and a level-triggered loop would spin on it. Give up the spare
+ * descriptor, accept and close the connection so the peer sees it end
+ * instead of hanging in the backlog, then take the spare back.
+ */
+void Acceptor::dropConnection()
+{
+    LOG_ERROR("%s:%s:%d sockfd reached limit, closing a new connection\n", __FILE__, __FUNCTION__, __LINE__);
+    ::close(idleFd_);
+    idleFd_ = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
     }
-}
\ No newline at end of file
+    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
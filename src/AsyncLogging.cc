@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <chrono>
+
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "Timestamp.h"
+
+AsyncLogging::AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval)
+    : flushInterval_(flushInterval),
+      running_(false),
+      basename_(basename),
+      rollSize_(rollSize),
+      thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"),
+      currentBuffer_(new LogBuffer),
+      nextBuffer_(new LogBuffer)
+{
+    buffers_.reserve(16);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void AsyncLogging::append(const char *logline, size_t len)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (currentBuffer_->avail() > len)
+    {
+        currentBuffer_->append(logline, len);
+        return;
+    }
+
+    buffers_.push_back(std::move(currentBuffer_));
+    if (nextBuffer_)
+    {
+        currentBuffer_ = std::move(nextBuffer_);
+    }
+    else
+    {
+        currentBuffer_.reset(new LogBuffer); // the backend is behind, rarely happens
+    }
+    currentBuffer_->append(logline, len);
+    cond_.notify_one();
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+    running_ = false;
+    cond_.notify_one();
+    thread_.join();
+}
+
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_);
+    BufferPtr newBuffer1(new LogBuffer);
+    BufferPtr newBuffer2(new LogBuffer);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(16);
+
+    while (running_)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty())
+            {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            // swap the full buffers out and hand the front end fresh ones
+            buffers_.push_back(std::move(currentBuffer_));
+            currentBuffer_ = std::move(newBuffer1);
+            buffersToWrite.swap(buffers_);
+            if (!nextBuffer_)
+            {
+                nextBuffer_ = std::move(newBuffer2);
+            }
+        }
+
+        // the front end outpaces the disk, drop the excess instead of eating memory
+        if (buffersToWrite.size() > 25)
+        {
+            char buf[256];
+            int n = snprintf(buf, sizeof buf, "Dropped log messages at %s, %zu larger buffers\n",
+                             Timestamp::now().toString().c_str(), buffersToWrite.size() - 2);
+            ::fputs(buf, stderr);
+            output.append(buf, n);
+            buffersToWrite.erase(buffersToWrite.begin() + 2, buffersToWrite.end());
+        }
+
+        for (const BufferPtr &buffer : buffersToWrite)
+        {
+            output.append(buffer->data(), buffer->length());
+        }
+
+        // keep two buffers for reuse, free the others
+        if (buffersToWrite.size() > 2)
+        {
+            buffersToWrite.resize(2);
+        }
+        if (!newBuffer1)
+        {
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+        if (!newBuffer2)
+        {
+            newBuffer2 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer2->reset();
+        }
+        buffersToWrite.clear();
+        output.flush();
+    }
+
+    // drain whatever was appended before stop()
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const BufferPtr &buffer : buffers_)
+    {
+        output.append(buffer->data(), buffer->length());
+    }
+    if (currentBuffer_)
+    {
+        output.append(currentBuffer_->data(), currentBuffer_->length());
+    }
+    output.flush();
+}
@@ -0,0 +1,37 @@
+#include "BlockPool.h"
+
+BlockPool::BlockPool(size_t maxFree)
+    : maxFree_(maxFree)
+{
+}
+
+BlockPool::~BlockPool()
+{
+    for (char *block : free_)
+    {
+        delete[] block;
+    }
+}
+
+char *BlockPool::allocate()
+{
+    if (free_.empty())
+    {
+        return new char[kBlockSize];
+    }
+    char *block = free_.back();
+    free_.pop_back();
+    return block;
+}
+
+void BlockPool::deallocate(char *block)
+{
+    if (free_.size() < maxFree_)
+    {
+        free_.push_back(block);
+    }
+    else
+    {
+        delete[] block;
+    }
+}
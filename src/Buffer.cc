@@ -1,12 +1,175 @@
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MUDUO_FIND_X86 1
+#endif
 
 #include "Buffer.h"
 
+/**
+ * Search kernels behind Buffer::findSeq. The needle's first and last bytes
+ * are compared against two overlapping loads, so one pair of vector compares
+ * tests 16 or 32 candidate positions and only those matching both are
+ * verified with memcmp. The scalar tail and the non-x86 fallback use memchr.
+ *
+ * Single bytes need no kernel of our own: glibc's memchr is already
+ * vectorized and dispatched by CPU, and measured faster than ours.
+ */
+using FindSeqFunc = const char *(*)(const char *begin, const char *end, const char *seq, size_t len);
+
+// len >= 2
+static const char *findSeqScalar(const char *begin, const char *end, const char *seq, size_t len)
+{
+    while (static_cast<size_t>(end - begin) >= len)
+    {
+        const char *p = static_cast<const char *>(::memchr(begin, seq[0], end - begin - len + 1));
+        if (p == nullptr)
+        {
+            return nullptr;
+        }
+        if (p[len - 1] == seq[len - 1] && ::memcmp(p + 1, seq + 1, len - 2) == 0)
+        {
+            return p;
+        }
+        begin = p + 1;
+    }
+    return nullptr;
+}
+
+#ifdef MUDUO_FIND_X86
+static __attribute__((target("sse2"))) const char *findSeqSse2(const char *begin, const char *end, const char *seq, size_t len)
+{
+    const __m128i first = _mm_set1_epi8(seq[0]);
+    const __m128i last = _mm_set1_epi8(seq[len - 1]);
+    for (; static_cast<size_t>(end - begin) >= 16 + len - 1; begin += 16)
+    {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + len - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                                        _mm_cmpeq_epi8(blockLast, last)));
+        while (mask)
+        {
+            int offset = __builtin_ctz(mask);
+            if (::memcmp(begin + offset + 1, seq + 1, len - 2) == 0)
+            {
+                return begin + offset;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findSeqScalar(begin, end, seq, len);
+}
+
+static __attribute__((target("avx2"))) const char *findSeqAvx2(const char *begin, const char *end, const char *seq, size_t len)
+{
+    const __m256i first = _mm256_set1_epi8(seq[0]);
+    const __m256i last = _mm256_set1_epi8(seq[len - 1]);
+    for (; static_cast<size_t>(end - begin) >= 32 + len - 1; begin += 32)
+    {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + len - 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                                              _mm256_cmpeq_epi8(blockLast, last)));
+        while (mask)
+        {
+            int offset = __builtin_ctz(mask);
+            if (::memcmp(begin + offset + 1, seq + 1, len - 2) == 0)
+            {
+                return begin + offset;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findSeqSse2(begin, end, seq, len);
+}
+#endif
+
+struct Finders
+{
+    const char *name;
+    FindSeqFunc findSeq;
+};
+
+static Finders selectFinders()
+{
+    Finders scalar = {"scalar", findSeqScalar};
+    const char *forced = ::getenv("MUDUO_BUFFER_FIND");
+    if (forced && ::strcmp(forced, "scalar") == 0)
+    {
+        return scalar;
+    }
+#ifdef MUDUO_FIND_X86
+    Finders sse2 = {"sse2", findSeqSse2};
+    Finders avx2 = {"avx2", findSeqAvx2};
+    __builtin_cpu_init(); // we may run before the constructor that normally does this
+    if (__builtin_cpu_supports("avx2") && !(forced && ::strcmp(forced, "sse2") == 0))
+    {
+        return avx2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return sse2;
+    }
+#endif
+    return scalar;
+}
+
+static const Finders &finders()
+{
+    static const Finders impl = selectFinders();
+    return impl;
+}
+
+const char *Buffer::findByte(const char *start, char c) const
+{
+    return static_cast<const char *>(::memchr(start, c, beginWrite() - start));
+}
+
+const char *Buffer::findSeq(const char *start, const char *seq, size_t len) const
+{
+    if (len <= 1)
+    {
+        return len == 0 ? start : findByte(start, seq[0]);
+    }
+    return finders().findSeq(start, beginWrite(), seq, len);
+}
+
+/**
+ * Lines are short, a vector loop spends most of its time in setup and tail
+ * there. Looking for the '\n' with memchr and checking the byte before it
+ * measured faster on header blocks than both kernels and std::search.
+ */
+const char *Buffer::findCRLF(const char *start) const
+{
+    const char *end = beginWrite();
+    if (end - start < 2)
+    {
+        return nullptr;
+    }
+    const char *lf = start + 1;
+    while ((lf = static_cast<const char *>(::memchr(lf, '\n', end - lf))) != nullptr)
+    {
+        if (lf[-1] == '\r')
+        {
+            return lf - 1;
+        }
+        ++lf;
+    }
+    return nullptr;
+}
+
+const char *Buffer::findImplementation()
+{
+    return finders().name;
+}
+
 ssize_t Buffer::readFd(int fd, int *savedErrno)
 {
-    char extrabuf[65536] = {0};
+    char extrabuf[kExtraReadSize] = {0};
 
     struct iovec vec[2];
     const size_t writable = writableBytes();
@@ -0,0 +1,55 @@
+#include "BufferPool.h"
+#include "Buffer.h"
+
+BufferPool::BufferPool()
+    : cachedBytes_(0)
+{
+}
+
+int BufferPool::classOf(size_t size)
+{
+    int cls = 0;
+    while (cls + 1 < kNumClasses && (kMinClassSize << (cls + 1)) <= size)
+    {
+        ++cls;
+    }
+    return cls;
+}
+
+std::vector<char> BufferPool::acquire(size_t size)
+{
+    const int wanted = classOf(size);
+    for (int cls = wanted; cls < kNumClasses; ++cls)
+    {
+        if (!free_[cls].empty())
+        {
+            std::vector<char> storage;
+            storage.swap(free_[cls].back());
+            free_[cls].pop_back();
+            cachedBytes_ -= storage.size();
+            return storage;
+        }
+    }
+    return std::vector<char>(Buffer::kCheapPrepend + (kMinClassSize << wanted));
+}
+
+void BufferPool::release(std::vector<char> &&storage)
+{
+    if (storage.empty())
+    {
+        return;
+    }
+    // file it under the largest class it can fully serve
+    size_t usable = storage.size() - Buffer::kCheapPrepend;
+    if (usable < kMinClassSize || usable > kMaxClassSize)
+    {
+        return; // freed when storage goes out of scope
+    }
+    int cls = classOf(usable);
+    if (free_[cls].size() < kMaxFreePerClass && cachedBytes_ + storage.size() <= kMaxCachedBytes)
+    {
+        cachedBytes_ += storage.size();
+        free_[cls].push_back(std::vector<char>());
+        free_[cls].back().swap(storage);
+    }
+}
@@ -7,6 +7,8 @@
 const int Channel::kNoneEvent = 0; 
 const int Channel::kReadEvent = EPOLLIN | EPOLLPRI; 
 const int Channel::kWriteEvent = EPOLLOUT;
+const int Channel::kExclusiveReadEvent = EPOLLIN | EPOLLEXCLUSIVE; // EPOLLPRI is rejected with it
+const int Channel::kEdgeEvents = EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLRDHUP | EPOLLET;
 
 Channel::Channel(EventLoop *loop, int fd)
     : loop_(loop),
@@ -14,6 +16,9 @@ Channel::Channel(EventLoop *loop, int fd)
       events_(0),
       revents_(0),
       index_(-1),
+      edgeTriggered_(false),
+      registered_(false),
+      completionMode_(kReadiness),
       tied_(false)
 {
 }
@@ -30,11 +35,19 @@ void Channel::tie(const std::shared_ptr<void> &obj)
 
 void Channel::update()
 {
+    // an edge-triggered mask never changes, only registering and removing reach the poller
+    bool registered = events_ != kNoneEvent;
+    if (edgeTriggered_ && registered == registered_)
+    {
+        return;
+    }
+    registered_ = registered;
     loop_->updateChannel(this);
 }
 
 void Channel::remove()
 {
+    registered_ = false;
     loop_->removeChannel(this);
 }
 
@@ -50,12 +63,18 @@ void Channel::handleEvent(Timestamp receiveTime)
     {
         handleEventWithGuard(receiveTime);
     }
+    completions_.clear();
 }
 
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {
-    LOG_INFO("channel handleEvent revents: %d\n", revents_);
-    if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN) && closeCallback_)
+    LOG_DEBUG("channel handleEvent revents: %d\n", revents_);
+    if (!completions_.empty() && completionCallback_)
+    {
+        completionCallback_(completions_.data(), completions_.size(), receiveTime);
+    }
+    // in completion mode the end of the stream arrives as a recv result instead
+    if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN) && completionMode_ == kReadiness && closeCallback_)
     {
         closeCallback_();
     }
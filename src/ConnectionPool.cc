@@ -0,0 +1,284 @@
+#include <stdio.h>
+
+#include "ConnectionPool.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "TcpClient.h"
+#include "TcpConnection.h"
+
+ConnectionPool::ConnectionPool(EventLoop *loop, const std::string &name)
+    : loop_(loop),
+      name_(name),
+      maxIdle_(8),
+      maxTotal_(64),
+      idleTimeout_(60.0),
+      acquireTimeout_(0.0),
+      nextWaiterId_(1),
+      nextClientId_(1),
+      evicting_(false),
+      alive_(std::make_shared<bool>(true))
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    if (evicting_)
+    {
+        loop_->cancel(evictTimer_);
+    }
+    for (auto &entry : upstreams_)
+    {
+        for (Waiter &waiter : entry.second.waiters)
+        {
+            if (acquireTimeout_ > 0)
+            {
+                loop_->cancel(waiter.timer);
+            }
+        }
+        for (IdleConnection &idle : entry.second.idle)
+        {
+            idle.conn->setMessageCallback(defaultMessageCallback);
+        }
+    }
+    // borrowed connections stay open, they just stop reporting to us
+    for (auto &entry : clients_)
+    {
+        TcpConnectionPtr conn = entry.first->connection();
+        if (conn)
+        {
+            conn->setConnectionCallback(defaultConnectionCallback);
+        }
+    }
+    // idle ones are now referenced by their TcpClient only, which closes them
+    upstreams_.clear();
+    owners_.clear();
+    clients_.clear();
+}
+
+void ConnectionPool::acquire(const InetAddress &addr, AcquireCallback cb)
+{
+    Upstream &up = upstream(addr);
+    while (!up.idle.empty())
+    {
+        TcpConnectionPtr conn = up.idle.back().conn;
+        up.idle.pop_back();
+        if (conn->connected())
+        {
+            owners_[conn.get()].borrowed = true;
+            cb(conn);
+            return;
+        }
+    }
+
+    Waiter waiter;
+    waiter.id = nextWaiterId_++;
+    waiter.callback = std::move(cb);
+    if (acquireTimeout_ > 0)
+    {
+        waiter.timer = loop_->runAfter(acquireTimeout_,
+                                       std::bind(&ConnectionPool::expireWaiter, this, addr.toIpPort(), waiter.id));
+    }
+    up.waiters.push_back(std::move(waiter));
+
+    if (up.total < maxTotal_)
+    {
+        openConnection(up);
+    }
+}
+
+void ConnectionPool::release(const TcpConnectionPtr &conn)
+{
+    auto owner = owners_.find(conn.get());
+    if (owner != owners_.end())
+    {
+        if (!owner->second.borrowed)
+        {
+            LOG_ERROR("ConnectionPool[%s] - %s released twice or never acquired\n",
+                      name_.c_str(), conn->name().c_str());
+            return;
+        }
+        owner->second.borrowed = false;
+    }
+
+    /**
+     * Deferred to the end of this loop iteration: the borrower usually
+     * releases from inside the connection's own message callback, which
+     * handOut() is about to replace. The pool may be gone by then.
+     */
+    std::weak_ptr<void> alive(alive_);
+    loop_->queueInLoop([this, alive, conn]()
+                       {
+                           if (!alive.lock())
+                           {
+                               return;
+                           }
+                           auto it = owners_.find(conn.get());
+                           if (it == owners_.end() || !conn->connected())
+                           {
+                               return; // a closed connection is accounted for by onConnection()
+                           }
+                           handOut(upstreams_.find(it->second.key)->second, conn);
+                       });
+}
+
+size_t ConnectionPool::idleCount(const InetAddress &addr) const
+{
+    auto it = upstreams_.find(addr.toIpPort());
+    return it == upstreams_.end() ? 0 : it->second.idle.size();
+}
+
+size_t ConnectionPool::totalCount(const InetAddress &addr) const
+{
+    auto it = upstreams_.find(addr.toIpPort());
+    return it == upstreams_.end() ? 0 : it->second.total;
+}
+
+ConnectionPool::Upstream &ConnectionPool::upstream(const InetAddress &addr)
+{
+    std::string key = addr.toIpPort();
+    auto it = upstreams_.find(key);
+    if (it == upstreams_.end())
+    {
+        it = upstreams_.emplace(key, Upstream(addr)).first;
+    }
+    return it->second;
+}
+
+void ConnectionPool::openConnection(Upstream &up)
+{
+    char buf[32] = {0};
+    snprintf(buf, sizeof buf, "#%d", nextClientId_++);
+    TcpClient *client = new TcpClient(loop_, up.addr, name_ + buf);
+    clients_[client].reset(client);
+
+    client->setConnectionCallback(
+        std::bind(&ConnectionPool::onConnection, this, up.addr.toIpPort(), client, std::placeholders::_1));
+    client->setMessageCallback(
+        std::bind(&ConnectionPool::onIdleMessage, this,
+                  std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    ++up.total;
+    client->connect();
+}
+
+void ConnectionPool::onConnection(const std::string &key, TcpClient *client, const TcpConnectionPtr &conn)
+{
+    Upstream &up = upstreams_.find(key)->second;
+    if (conn->connected())
+    {
+        Owner owner = {key, client, false};
+        owners_[conn.get()] = owner;
+        handOut(up, conn);
+        return;
+    }
+
+    // closed by the peer, by eviction or by a borrower
+    LOG_DEBUG("ConnectionPool[%s] - %s closed\n", name_.c_str(), conn->name().c_str());
+    owners_.erase(conn.get());
+    removeIdle(up, conn);
+    --up.total;
+
+    // we are inside the client's callback, it can only be deleted afterwards
+    auto it = clients_.find(client);
+    if (it != clients_.end())
+    {
+        TcpClient *done = it->second.release();
+        clients_.erase(it);
+        loop_->queueInLoop([done]()
+                           { delete done; });
+    }
+
+    if (!up.waiters.empty() && up.total < maxTotal_)
+    {
+        openConnection(up);
+    }
+}
+
+void ConnectionPool::onIdleMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    // an idle upstream has nothing to say, whatever it sent leaves the stream out of sync
+    size_t n = buf->readableBytes();
+    buf->retrieveAll();
+    LOG_ERROR("ConnectionPool[%s] - %s got %lu unexpected bytes, evicting\n",
+              name_.c_str(), conn->name().c_str(), (unsigned long)n);
+    conn->forceClose();
+}
+
+void ConnectionPool::handOut(Upstream &up, const TcpConnectionPtr &conn)
+{
+    conn->setMessageCallback(
+        std::bind(&ConnectionPool::onIdleMessage, this,
+                  std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    if (!up.waiters.empty())
+    {
+        Waiter waiter = std::move(up.waiters.front());
+        up.waiters.pop_front();
+        if (acquireTimeout_ > 0)
+        {
+            loop_->cancel(waiter.timer);
+        }
+        owners_[conn.get()].borrowed = true;
+        waiter.callback(conn);
+    }
+    else if (up.idle.size() >= maxIdle_)
+    {
+        conn->forceClose();
+    }
+    else
+    {
+        IdleConnection idle;
+        idle.conn = conn;
+        idle.since = Timestamp::now();
+        up.idle.push_back(idle);
+        if (idleTimeout_ > 0 && !evicting_)
+        {
+            evicting_ = true;
+            double interval = idleTimeout_ / 2 > 1.0 ? 1.0 : idleTimeout_ / 2;
+            evictTimer_ = loop_->runEvery(interval, std::bind(&ConnectionPool::evictIdle, this));
+        }
+    }
+}
+
+void ConnectionPool::removeIdle(Upstream &up, const TcpConnectionPtr &conn)
+{
+    for (auto it = up.idle.begin(); it != up.idle.end(); ++it)
+    {
+        if (it->conn == conn)
+        {
+            up.idle.erase(it);
+            return;
+        }
+    }
+}
+
+void ConnectionPool::expireWaiter(const std::string &key, uint64_t id)
+{
+    Upstream &up = upstreams_.find(key)->second;
+    for (auto it = up.waiters.begin(); it != up.waiters.end(); ++it)
+    {
+        if (it->id == id)
+        {
+            AcquireCallback cb = std::move(it->callback);
+            up.waiters.erase(it);
+            LOG_INFO("ConnectionPool[%s] - acquire %s timed out\n", name_.c_str(), key.c_str());
+            cb(TcpConnectionPtr());
+            return;
+        }
+    }
+}
+
+void ConnectionPool::evictIdle()
+{
+    Timestamp now = Timestamp::now();
+    for (auto &entry : upstreams_)
+    {
+        std::deque<IdleConnection> &idle = entry.second.idle;
+        // the front has been idle the longest
+        while (!idle.empty() && timeDifference(now, idle.front().since) >= idleTimeout_)
+        {
+            TcpConnectionPtr conn = idle.front().conn;
+            idle.pop_front();
+            conn->forceClose();
+        }
+    }
+}
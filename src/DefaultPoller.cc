@@ -2,6 +2,10 @@
 
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "Logger.h"
+#ifdef MUDUO_HAVE_IO_URING
+#include "IoUringPoller.h"
+#endif
 
 Poller *Poller::newDefaultPoller(EventLoop *loop)
 {
@@ -9,8 +13,19 @@ Poller *Poller::newDefaultPoller(EventLoop *loop)
     {
         return nullptr; // 生成poll的实例
     }
+    else if (::getenv("MUDUO_USE_IO_URING"))
+    {
+#ifdef MUDUO_HAVE_IO_URING
+        if (IoUringPoller::isSupported())
+        {
+            return new IoUringPoller(loop); // 生成io_uring的实例
+        }
+#endif
+        LOG_ERROR("io_uring is not supported, fall back to epoll\n");
+        return new EPollPoller(loop);
+    }
     else
     {
         return new EPollPoller(loop); // 生成epoll的实例
     }
-}
\ No newline at end of file
+}
@@ -28,13 +28,13 @@ EPollPoller::~EPollPoller()
 
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
-    LOG_INFO("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
+    LOG_DEBUG("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
     int numEvents = ::epoll_wait(epollfd_, events_.data(), static_cast<int>(events_.size()), timeoutMs);
     Timestamp now(Timestamp::now());
 
     if (numEvents > 0)
     {
-        LOG_INFO("%d events happened \n", numEvents);
+        LOG_DEBUG("%d events happened \n", numEvents);
         fillActiveChannels(numEvents, activeChannels);
         if (static_cast<size_t>(numEvents) == events_.size())
         {
@@ -55,7 +55,7 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 void EPollPoller::updateChannel(Channel *channel)
 {
     const int index = channel->index();
-    LOG_INFO("func=%s => fd=%d events=%d index=%d\n", __FUNCTION__,
+    LOG_DEBUG("func=%s => fd=%d events=%d index=%d\n", __FUNCTION__,
              channel->fd(), channel->events(), index);
     if (index == kNew || index == kDeleted)
     {
@@ -87,7 +87,7 @@ void EPollPoller::removeChannel(Channel *channel)
     int fd = channel->fd();
     channels_.erase(fd);
 
-    LOG_INFO("func=%s => fd=%d \n", __FUNCTION__, fd);
+    LOG_DEBUG("func=%s => fd=%d \n", __FUNCTION__, fd);
 
     int index = channel->index();
     if (index == kAdded)
@@ -113,7 +113,7 @@ void EPollPoller::update(int operation, Channel *channel)
     ::memset(&event, 0, sizeof event);
     int fd = channel->fd();
     
-    event.events = static_cast<uint32_t>(channel->events());
+    event.events = static_cast<uint32_t>(channel->pollEvents());
     event.data.ptr = channel;
 
     if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
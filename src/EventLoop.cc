@@ -8,11 +8,21 @@
 #include "Logger.h"
 #include "Channel.h"
 #include "Poller.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
+#include "BlockPool.h"
+#include "BufferPool.h"
 
 __thread EventLoop *t_loopInThisThread = nullptr;
 
 const int kPollTimeMs = 10000;
 
+// how often a loop publishes its busy ratio and throughput
+const int64_t kLoadWindowMicroSeconds = 100 * 1000;
+
+// resolution of the per-loop timing wheel, idle timeouts fire within one tick
+const double kWheelTickSeconds = 1.0;
+
 int createEventFd()
 {
     int evtfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
@@ -26,11 +36,22 @@ int createEventFd()
 EventLoop::EventLoop()
     : looping_(false),
       quit_(false),
-      callingPendingFunctors_(false),
       threadId_(CurrentThread::tid()),
       poller_(Poller::newDefaultPoller(this)),
+      timerQueue_(new TimerQueue(this)),
+      blockPool_(new BlockPool),
+      bufferPool_(new BufferPool),
       wakeupFd_(createEventFd()),
-      wakeupChannel_(new Channel(this, wakeupFd_))
+      wakeupChannel_(new Channel(this, wakeupFd_)),
+      callingPendingFunctors_(false),
+      wakeupPending_(false),
+      busyPollMicroSeconds_(0),
+      loadWindowStart_(Timestamp::now()),
+      busyMicroSeconds_(0),
+      bytesInWindow_(0),
+      activeConnections_(0),
+      busyPermille_(0),
+      bytesPerSecond_(0)
 {
     LOG_DEBUG("EventLoop created %p in thread %d\n", this, threadId_);
     if (t_loopInThisThread)
@@ -58,14 +79,24 @@ EventLoop::~EventLoop()
 void EventLoop::loop()
 {
     looping_ = true;
-    quit_ = false;
+    // quit_ is not reset here: a quit() issued before the loop started still counts
 
     LOG_INFO("EventLoop %p start looping\n", this);
 
+    iterationEndTime_ = Timestamp::now();
     while (!quit_)
     {
         activeChannels_.clear();
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        // busy-poll: keep polling without sleeping for a while after the last activity
+        int timeoutMs = kPollTimeMs;
+        if (busyPollMicroSeconds_ > 0 &&
+            pollReturnTime_.microSecondsSinceEpoch() - lastActiveTime_.microSecondsSinceEpoch() < busyPollMicroSeconds_)
+        {
+            timeoutMs = 0;
+        }
+        pollReturnTime_ = poller_->poll(timeoutMs, &activeChannels_);
+        metrics_.pollWaitUs.record(pollReturnTime_.microSecondsSinceEpoch() - iterationEndTime_.microSecondsSinceEpoch());
+        metrics_.activeChannels.record(activeChannels_.size());
         for (Channel *channel : activeChannels_)
         {
             /**
@@ -74,9 +105,19 @@ void EventLoop::loop()
              */
             channel->handleEvent(pollReturnTime_);
         }
-        doPendingFunctors();
+        size_t functors = doPendingFunctors();
+        metrics_.pendingFunctors.record(functors);
+        metrics_.functorsRun.add(functors);
+        metrics_.iterations.add(1);
+        if (functors > 0 || !activeChannels_.empty())
+        {
+            lastActiveTime_ = pollReturnTime_;
+        }
+        updateLoad();
     }
     LOG_INFO("EventLoop %p stop looping\n", this);
+    // this quit() is consumed, the loop can be run again
+    quit_ = false;
     looping_ = false;
 }
 
@@ -89,6 +130,35 @@ void EventLoop::quit()
     }
 }
 
+void EventLoop::setBusyPoll(int microSeconds)
+{
+    runInLoop([this, microSeconds]()
+              { busyPollMicroSeconds_ = microSeconds; });
+}
+
+/**
+ * Everything since poll() returned counts as busy. A loop that slept in
+ * poll() for a long time publishes a low ratio on its next iteration, so the
+ * published numbers are at most one poll timeout old.
+ */
+void EventLoop::updateLoad()
+{
+    Timestamp now(Timestamp::now());
+    int64_t busy = now.microSecondsSinceEpoch() - pollReturnTime_.microSecondsSinceEpoch();
+    busyMicroSeconds_ += busy;
+    metrics_.processingUs.record(busy);
+    iterationEndTime_ = now;
+    int64_t window = now.microSecondsSinceEpoch() - loadWindowStart_.microSecondsSinceEpoch();
+    if (window >= kLoadWindowMicroSeconds)
+    {
+        busyPermille_.store(static_cast<int>(busyMicroSeconds_ * 1000 / window), std::memory_order_relaxed);
+        bytesPerSecond_.store(bytesInWindow_ * Timestamp::kMicroSecondsPerSecond / window, std::memory_order_relaxed);
+        loadWindowStart_ = now;
+        busyMicroSeconds_ = 0;
+        bytesInWindow_ = 0;
+    }
+}
+
 // run cb in current EventLoop
 void EventLoop::runInLoop(Functor cb)
 {
@@ -98,24 +168,58 @@ void EventLoop::runInLoop(Functor cb)
     }
     else
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }
 }
 
 // put cb into queue, wake up loop later to run cb
 void EventLoop::queueInLoop(Functor cb)
 {
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
-    }
-    if (! isInLoopThread() || callingPendingFunctors_)
+    pendingFunctors_.push(std::move(cb));
+    /**
+     * Only the first post after the loop last drained writes the eventfd,
+     * a burst of posts costs one syscall. The exchange pairs with the one in
+     * doPendingFunctors, so a post that skips the write is seen by the drain.
+     */
+    if ((! isInLoopThread() || callingPendingFunctors_) &&
+        ! wakeupPending_.exchange(true, std::memory_order_acq_rel))
     {
         wakeup();
     }
 
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+TimingWheel *EventLoop::timingWheel()
+{
+    if (!timingWheel_)
+    {
+        timingWheel_.reset(new TimingWheel(this, kWheelTickSeconds));
+    }
+    return timingWheel_.get();
+}
+
 void EventLoop::handleRead()
 {
     uint64_t one = 1;
@@ -136,6 +240,16 @@ void EventLoop::wakeup()
     }
 }
 
+bool EventLoop::supportsEdgeTriggered() const
+{
+    return poller_->supportsEdgeTriggered();
+}
+
+bool EventLoop::supportsCompletions() const
+{
+    return poller_->supportsCompletions();
+}
+
 void EventLoop::updateChannel(Channel *channel)
 {
     poller_->updateChannel(channel);
@@ -151,18 +265,14 @@ bool EventLoop::hasChannel(Channel *channel)
     return poller_->hasChannel(channel);
 }
 
-void EventLoop::doPendingFunctors()
+size_t EventLoop::doPendingFunctors()
 {
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pendingFunctors_);
-    }
-    for (const Functor &functor : functors)
-    {
-        functor();
-    }
+    wakeupPending_.exchange(false, std::memory_order_acq_rel);
+    // functors queued while draining run in the next iteration, like the old vector swap
+    size_t count = pendingFunctors_.drain([](Functor &functor)
+                                          { functor(); });
 
     callingPendingFunctors_ = false;
+    return count;
 }
\ No newline at end of file
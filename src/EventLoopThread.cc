@@ -1,5 +1,12 @@
+#include <sched.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
 #include "EventLoopThread.h"
 #include "EventLoop.h"
+#include "Logger.h"
 
 EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
                                  const std::string &name)
@@ -8,7 +15,9 @@ EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
       thread_(std::bind(&EventLoopThread::threadFunc, this), name),
       mutex_(),
       cond_(),
-      callback_(cb)
+      callback_(cb),
+      cpu_(-1),
+      numaNode_(-1)
 {
 }
 
@@ -38,6 +47,8 @@ EventLoop *EventLoopThread::startLoop()
 
 void EventLoopThread::threadFunc()
 {
+    // before the EventLoop exists, its pools are first touched on the right node
+    bindToCpu();
     EventLoop loop;
 
     if (callback_)
@@ -52,4 +63,36 @@ void EventLoopThread::threadFunc()
     loop.loop();
     std::unique_lock<std::mutex> lock(mutex_);
     loop_ = nullptr;
-}
\ No newline at end of file
+}
+
+void EventLoopThread::bindToCpu()
+{
+    if (cpu_ < 0)
+    {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu_, &set);
+    if (::sched_setaffinity(0, sizeof set, &set) < 0)
+    {
+        LOG_ERROR("EventLoopThread %s: bind to cpu %d failed:%d\n", name().c_str(), cpu_, errno);
+        cpu_ = -1;
+        return;
+    }
+
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) < 0)
+    {
+        return;
+    }
+    numaNode_ = static_cast<int>(node);
+    // preferred, not bound: a full node still falls back to the others
+    unsigned long nodemask = 1UL << node;
+    if (node < sizeof nodemask * 8 &&
+        ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodemask, sizeof nodemask * 8) < 0)
+    {
+        LOG_DEBUG("EventLoopThread %s: set_mempolicy node %u failed:%d\n", name().c_str(), node, errno);
+    }
+}
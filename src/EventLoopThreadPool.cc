@@ -1,15 +1,42 @@
 #include <memory>
+#include <sched.h>
 
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
 #include "Logger.h"
 
+// two loops whose busy ratios differ by less than this count as equally busy
+const int kBusyTolerancePermille = 50;
+
+// whether a should get the next connection rather than b
+static bool lessLoaded(const EventLoop *a, const EventLoop *b)
+{
+    int busyA = a->busyPermille();
+    int busyB = b->busyPermille();
+    if (busyA - busyB > kBusyTolerancePermille || busyB - busyA > kBusyTolerancePermille)
+    {
+        return busyA < busyB;
+    }
+    int64_t bytesA = a->bytesPerSecond();
+    int64_t bytesB = b->bytesPerSecond();
+    if (bytesA != bytesB)
+    {
+        return bytesA < bytesB;
+    }
+    return a->activeConnections() < b->activeConnections();
+}
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
     : baseLoop_(baseLoop),
       name_(nameArg),
       started_(false),
       numThreads_(0),
-      next_(0)
+      next_(0),
+      policy_(kRoundRobin),
+      randomState_(2463534242u),
+      autoCpuAffinity_(false)
 {
 }
 
@@ -19,14 +46,44 @@ EventLoopThreadPool::~EventLoopThreadPool()
     // refer EventLoopThread::threadFunc
 }
 
+// one CPU per loop from the ones this process may run on, the base loop's last
+static std::vector<int> autoCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof allowed, &allowed) < 0)
+    {
+        return cpus;
+    }
+    int baseCpu = ::sched_getcpu();
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed) && cpu != baseCpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    if (baseCpu >= 0 && CPU_ISSET(baseCpu, &allowed))
+    {
+        cpus.push_back(baseCpu); // shared only when there are more loops than CPUs
+    }
+    return cpus;
+}
+
 void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 {
     started_ = true;
+    std::vector<int> cpus = autoCpuAffinity_ ? autoCpus() : cpus_;
     for (int i = 0; i < numThreads_; ++i)
     {
         char buf[32 + name_.size()];
         snprintf(buf, sizeof buf, "%s_%d", name_.c_str(), i);
         EventLoopThread *t = new EventLoopThread(cb, buf);
+        if (!cpus.empty())
+        {
+            t->setCpu(cpus[i % cpus.size()]);
+        }
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         loops_.push_back(t->startLoop());
     }
@@ -56,6 +113,72 @@ EventLoop *EventLoopThreadPool::getNextLoop()
     return loop;
 }
 
+EventLoop *EventLoopThreadPool::getLoopForPeer(const InetAddress &peerAddr)
+{
+    const size_t n = loops_.size();
+    if (n <= 1 || policy_ == kRoundRobin)
+    {
+        return getNextLoop();
+    }
+
+    switch (policy_)
+    {
+    case kLeastConnections:
+    {
+        // start after the last pick so ties still rotate
+        EventLoop *best = nullptr;
+        for (size_t i = 0; i < n; ++i)
+        {
+            EventLoop *loop = loops_[(next_ + i) % n];
+            if (best == nullptr || loop->activeConnections() < best->activeConnections())
+            {
+                best = loop;
+            }
+        }
+        next_ = static_cast<int>((next_ + 1) % n);
+        return best;
+    }
+    case kPowerOfTwoChoices:
+    {
+        randomState_ ^= randomState_ << 13;
+        randomState_ ^= randomState_ >> 17;
+        randomState_ ^= randomState_ << 5;
+        size_t i = randomState_ % n;
+        size_t j = (i + 1 + (randomState_ >> 16) % (n - 1)) % n; // never equal to i
+        return lessLoaded(loops_[j], loops_[i]) ? loops_[j] : loops_[i];
+    }
+    case kPeerHash:
+    {
+        // Knuth's multiplicative hash, its high bits mix all of the address
+        uint32_t ip = ntohl(peerAddr.getSockAddr()->sin_addr.s_addr);
+        return loops_[((ip * 2654435761u) >> 16) % n];
+    }
+    default:
+        return getNextLoop();
+    }
+}
+
+std::vector<EventLoopThreadPool::LoopPlacement> EventLoopThreadPool::layout() const
+{
+    std::vector<LoopPlacement> placements;
+    for (const std::unique_ptr<EventLoopThread> &t : threads_)
+    {
+        LoopPlacement placement = {t->name(), t->cpu(), t->numaNode()};
+        placements.push_back(placement);
+    }
+    return placements;
+}
+
+LoopMetrics::Snapshot EventLoopThreadPool::metrics()
+{
+    LoopMetrics::Snapshot total;
+    for (EventLoop *loop : getAllLoops())
+    {
+        total += loop->metrics().snapshot();
+    }
+    return total;
+}
+
 std::vector<EventLoop *> EventLoopThreadPool::getAllLoops()
 {
     if (loops_.empty())
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "HttpContext.h"
+#include "Buffer.h"
+
+// a chunk-size line is a hex number plus optional extensions, never this long
+static const size_t kMaxChunkLineBytes = 1024;
+
+const char *HttpContext::findLine(Buffer *buf)
+{
+    const char *crlf = buf->findCRLF(buf->peek() + scanned_);
+    if (crlf)
+    {
+        scanned_ = 0;
+        return crlf;
+    }
+    // the last byte may be a '\r' whose '\n' is still in flight
+    size_t readable = buf->readableBytes();
+    scanned_ = readable > 0 ? readable - 1 : 0;
+    return nullptr;
+}
+
+// METHOD SP request-target SP HTTP-version
+bool HttpContext::processRequestLine(const char *begin, const char *end)
+{
+    const char *space = std::find(begin, end, ' ');
+    if (space == end || !request_.setMethod(begin, space))
+    {
+        return fail(space == end ? HttpResponse::k400BadRequest : HttpResponse::k501NotImplemented);
+    }
+    begin = space + 1;
+    space = std::find(begin, end, ' ');
+    if (space == end)
+    {
+        return fail(HttpResponse::k400BadRequest);
+    }
+    const char *question = std::find(begin, space, '?');
+    request_.setPath(begin, question);
+    if (question != space)
+    {
+        request_.setQuery(question + 1, space);
+    }
+    begin = space + 1;
+    if (end - begin != 8 || ::strncmp(begin, "HTTP/1.", 7) != 0)
+    {
+        return fail(HttpResponse::k400BadRequest);
+    }
+    if (begin[7] == '1')
+    {
+        request_.setVersion(HttpRequest::kHttp11);
+    }
+    else if (begin[7] == '0')
+    {
+        request_.setVersion(HttpRequest::kHttp10);
+    }
+    else
+    {
+        return fail(HttpResponse::k400BadRequest);
+    }
+    return true;
+}
+
+// decide how the body is delimited once the empty line after the headers is seen
+bool HttpContext::processHeadersDone()
+{
+    std::string transferEncoding = request_.getHeader("Transfer-Encoding");
+    if (!transferEncoding.empty())
+    {
+        // chunked must be the final coding, anything else we can't decode
+        size_t n = transferEncoding.size();
+        if (n < 7 || ::strcasecmp(transferEncoding.c_str() + n - 7, "chunked") != 0)
+        {
+            return fail(HttpResponse::k501NotImplemented);
+        }
+        state_ = kExpectChunkSize;
+        return true;
+    }
+
+    std::string contentLength = request_.getHeader("Content-Length");
+    if (contentLength.empty())
+    {
+        state_ = kGotAll;
+        return true;
+    }
+    char *endptr = nullptr;
+    errno = 0;
+    unsigned long long length = ::strtoull(contentLength.c_str(), &endptr, 10);
+    if (errno != 0 || endptr == contentLength.c_str() || *endptr != '\0' || contentLength[0] == '-')
+    {
+        return fail(HttpResponse::k400BadRequest);
+    }
+    if (length > maxBodySize_)
+    {
+        return fail(HttpResponse::k413PayloadTooLarge);
+    }
+    bodyRemaining_ = static_cast<size_t>(length);
+    if (bodyRemaining_ > 0)
+    {
+        request_.body().reserve(bodyRemaining_);
+    }
+    state_ = bodyRemaining_ > 0 ? kExpectBody : kGotAll;
+    return true;
+}
+
+// chunk-size [; extensions]
+bool HttpContext::processChunkSize(const char *begin, const char *end)
+{
+    const char *digitsEnd = begin;
+    size_t size = 0;
+    while (digitsEnd < end && ::isxdigit(static_cast<unsigned char>(*digitsEnd)))
+    {
+        char c = *digitsEnd;
+        int digit = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+        if (size > (maxBodySize_ >> 4))
+        {
+            return fail(HttpResponse::k413PayloadTooLarge);
+        }
+        size = size * 16 + digit;
+        ++digitsEnd;
+    }
+    if (digitsEnd == begin)
+    {
+        return fail(HttpResponse::k400BadRequest);
+    }
+    if (size == 0)
+    {
+        state_ = kExpectTrailers;
+        return true;
+    }
+    if (request_.body().size() + size > maxBodySize_)
+    {
+        return fail(HttpResponse::k413PayloadTooLarge);
+    }
+    bodyRemaining_ = size;
+    state_ = kExpectChunkData;
+    return true;
+}
+
+bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime)
+{
+    while (state_ != kGotAll)
+    {
+        switch (state_)
+        {
+        case kExpectRequestLine:
+        case kExpectHeaders:
+        case kExpectTrailers:
+        {
+            const char *crlf = findLine(buf);
+            if (!crlf)
+            {
+                if (headerBytes_ + buf->readableBytes() > kMaxHeaderBytes)
+                {
+                    return fail(HttpResponse::k431RequestHeaderFieldsTooLarge);
+                }
+                return true; // wait for more
+            }
+            headerBytes_ += crlf + 2 - buf->peek();
+            if (headerBytes_ > kMaxHeaderBytes)
+            {
+                return fail(HttpResponse::k431RequestHeaderFieldsTooLarge);
+            }
+
+            if (state_ == kExpectRequestLine)
+            {
+                if (crlf == buf->peek())
+                {
+                    // tolerate empty lines between pipelined requests
+                    buf->retrieve(2);
+                    headerBytes_ = 0;
+                    continue;
+                }
+                if (!processRequestLine(buf->peek(), crlf))
+                {
+                    return false;
+                }
+                request_.setReceiveTime(receiveTime);
+                state_ = kExpectHeaders;
+            }
+            else if (crlf == buf->peek())
+            {
+                // the empty line ends the headers or the trailers
+                if (state_ == kExpectTrailers)
+                {
+                    state_ = kGotAll;
+                }
+                else if (!processHeadersDone())
+                {
+                    return false;
+                }
+            }
+            else if (state_ == kExpectHeaders)
+            {
+                const char *colon = std::find(buf->peek(), crlf, ':');
+                if (colon == crlf || colon == buf->peek())
+                {
+                    return fail(HttpResponse::k400BadRequest);
+                }
+                request_.addHeader(buf->peek(), colon, crlf);
+            }
+            // trailer fields are dropped
+            buf->retrieveUntil(crlf + 2);
+            break;
+        }
+
+        case kExpectChunkSize:
+        {
+            const char *crlf = findLine(buf);
+            if (!crlf)
+            {
+                if (buf->readableBytes() > kMaxChunkLineBytes)
+                {
+                    return fail(HttpResponse::k400BadRequest);
+                }
+                return true;
+            }
+            if (!processChunkSize(buf->peek(), crlf))
+            {
+                return false;
+            }
+            buf->retrieveUntil(crlf + 2);
+            break;
+        }
+
+        case kExpectBody:
+        case kExpectChunkData:
+        {
+            size_t n = std::min(bodyRemaining_, buf->readableBytes());
+            if (n == 0)
+            {
+                return true;
+            }
+            request_.body().append(buf->peek(), n);
+            buf->retrieve(n);
+            bodyRemaining_ -= n;
+            if (bodyRemaining_ == 0)
+            {
+                state_ = state_ == kExpectBody ? kGotAll : kExpectChunkEnd;
+            }
+            break;
+        }
+
+        case kExpectChunkEnd:
+        {
+            if (buf->readableBytes() < 2)
+            {
+                return true;
+            }
+            if (buf->peek()[0] != '\r' || buf->peek()[1] != '\n')
+            {
+                return fail(HttpResponse::k400BadRequest);
+            }
+            buf->retrieve(2);
+            state_ = kExpectChunkSize;
+            break;
+        }
+
+        default:
+            return true;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "HttpResponse.h"
+#include "Buffer.h"
+
+static const char *reasonPhrase(HttpResponse::HttpStatusCode code)
+{
+    switch (code)
+    {
+    case HttpResponse::k200Ok:
+        return "OK";
+    case HttpResponse::k204NoContent:
+        return "No Content";
+    case HttpResponse::k301MovedPermanently:
+        return "Moved Permanently";
+    case HttpResponse::k400BadRequest:
+        return "Bad Request";
+    case HttpResponse::k404NotFound:
+        return "Not Found";
+    case HttpResponse::k413PayloadTooLarge:
+        return "Payload Too Large";
+    case HttpResponse::k431RequestHeaderFieldsTooLarge:
+        return "Request Header Fields Too Large";
+    case HttpResponse::k500InternalServerError:
+        return "Internal Server Error";
+    case HttpResponse::k501NotImplemented:
+        return "Not Implemented";
+    default:
+        return "Unknown";
+    }
+}
+
+static void appendString(Buffer *output, const char *s)
+{
+    output->append(s, ::strlen(s));
+}
+
+static void appendString(Buffer *output, const std::string &s)
+{
+    output->append(s.data(), s.size());
+}
+
+void HttpResponse::appendToBuffer(Buffer *output, bool withBody) const
+{
+    char buf[64];
+    int n = snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_ == kUnknown ? 500 : statusCode_);
+    output->append(buf, n);
+    if (statusMessage_.empty())
+    {
+        appendString(output, reasonPhrase(statusCode_));
+    }
+    else
+    {
+        appendString(output, statusMessage_);
+    }
+    appendString(output, "\r\n");
+
+    if (closeConnection_)
+    {
+        appendString(output, "Connection: close\r\n");
+    }
+    else
+    {
+        appendString(output, "Connection: Keep-Alive\r\n");
+    }
+    n = snprintf(buf, sizeof buf, "Content-Length: %zu\r\n", body_.size());
+    output->append(buf, n);
+
+    for (std::map<std::string, std::string>::const_iterator it = headers_.begin(); it != headers_.end(); ++it)
+    {
+        appendString(output, it->first);
+        appendString(output, ": ");
+        appendString(output, it->second);
+        appendString(output, "\r\n");
+    }
+    appendString(output, "\r\n");
+    if (withBody)
+    {
+        appendString(output, body_);
+    }
+}
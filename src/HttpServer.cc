@@ -0,0 +1,96 @@
+#include <strings.h>
+
+#include "HttpServer.h"
+#include "HttpContext.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Logger.h"
+
+static void defaultHttpCallback(const HttpRequest &, HttpResponse *resp)
+{
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setCloseConnection(true);
+}
+
+HttpServer::HttpServer(EventLoop *loop,
+                       const InetAddress &listenAddr,
+                       const std::string &name,
+                       TcpServer::Option option)
+    : loop_(loop),
+      server_(loop, listenAddr, name, option),
+      httpCallback_(defaultHttpCallback),
+      maxBodySize_(64 * 1024 * 1024)
+{
+    server_.setConnectionCallback(std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&HttpServer::onMessage, this,
+                                         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+void HttpServer::start()
+{
+    LOG_INFO("HttpServer[%s] starts listening on %s\n",
+             server_.name().c_str(), server_.ipPort().c_str());
+    server_.start();
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setContext(std::make_shared<HttpContext>(maxBodySize_));
+    }
+}
+
+void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    if (!conn->connected())
+    {
+        buf->retrieveAll(); // after our shutdown(), nothing could be answered
+        return;
+    }
+    HttpContext *context = static_cast<HttpContext *>(conn->getContext().get());
+    // one per IO thread, its storage is reused by every response written in that thread
+    static thread_local Buffer output;
+
+    bool close = false;
+    while (!close)
+    {
+        if (!context->parseRequest(buf, receiveTime))
+        {
+            HttpResponse response(true);
+            response.setStatusCode(context->error());
+            response.appendToBuffer(&output);
+            close = true;
+            break;
+        }
+        if (!context->gotAll())
+        {
+            break; // the rest of the request is still in flight
+        }
+        close = onRequest(context->request(), &output);
+        context->reset();
+    }
+
+    if (output.readableBytes() > 0)
+    {
+        conn->send(&output);
+        // send() leaves it alone if the connection went down meanwhile, the next one mustn't get it
+        output.retrieveAll();
+    }
+    if (close)
+    {
+        buf->retrieveAll(); // whatever was pipelined after it goes unanswered
+        conn->shutdown();
+    }
+}
+
+bool HttpServer::onRequest(const HttpRequest &req, Buffer *output)
+{
+    const std::string connection = req.getHeader("Connection");
+    bool close = ::strcasecmp(connection.c_str(), "close") == 0 ||
+                 (req.version() == HttpRequest::kHttp10 && ::strcasecmp(connection.c_str(), "Keep-Alive") != 0);
+    HttpResponse response(close);
+    httpCallback_(req, &response);
+    response.appendToBuffer(output, req.method() != HttpRequest::kHead);
+    return response.closeConnection();
+}
@@ -8,7 +8,7 @@ InetAddress::InetAddress(uint16_t port, std::string ip)
     ::memset(&addr_, 0, sizeof addr_);
     addr_.sin_family = AF_INET;
     // local stream transfer to net stream
-    addr_.sin_port = ::htonl(port); 
+    addr_.sin_port = ::htons(port);
     addr_.sin_addr.s_addr = ::inet_addr(ip.c_str());
 }
 
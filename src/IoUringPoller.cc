@@ -0,0 +1,547 @@
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <linux/io_uring.h>
+
+#include "IoUringPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+
+const int kNew = -1;
+const int kAdded = 1;
+const int kDeleted = 2;
+
+// user_data of POLL_REMOVE and ASYNC_CANCEL requests, never matches a request token
+const uint64_t kRemoveTag = ~0ULL;
+
+// operation of a request, bits 30-31 of its token
+const int kPollOp = 0;
+const int kRecvOp = 1;
+const int kAcceptOp = 2;
+const uint32_t kGenerationMask = (1U << 30) - 1;
+
+static int ioUringSetup(unsigned entries, io_uring_params *p)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static uint64_t makeToken(int fd, int op, uint32_t generation)
+{
+    return (static_cast<uint64_t>(fd) << 32) | (static_cast<uint64_t>(op) << 30) | (generation & kGenerationMask);
+}
+
+static int ioUringRegister(int ringfd, unsigned opcode, void *arg, unsigned nrArgs)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, ringfd, opcode, arg, nrArgs));
+}
+
+bool IoUringPoller::isSupported()
+{
+    io_uring_params params;
+    ::memset(&params, 0, sizeof params);
+    int fd = ioUringSetup(4, &params);
+    if (fd < 0)
+    {
+        return false;
+    }
+    ::close(fd);
+    // EXT_ARG (5.11) is needed to wait for completions with a timeout
+    return (params.features & IORING_FEAT_EXT_ARG) && (params.features & IORING_FEAT_NODROP);
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop),
+      ringfd_(-1),
+      sqRing_(MAP_FAILED),
+      sqRingSize_(0),
+      sqes_(nullptr),
+      sqesSize_(0),
+      sqLocalTail_(0),
+      toSubmit_(0),
+      cqRing_(MAP_FAILED),
+      cqRingSize_(0),
+      bufRing_(nullptr),
+      bufRingSize_(0),
+      buffers_(nullptr),
+      bufLocalTail_(0),
+      round_(0)
+{
+    io_uring_params params;
+    ::memset(&params, 0, sizeof params);
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = kRingEntries * 4;
+    ringfd_ = ioUringSetup(kRingEntries, &params);
+    if (ringfd_ < 0)
+    {
+        LOG_FATAL("io_uring_setup error:%d \n", errno);
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ringfd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        LOG_FATAL("io_uring sq ring mmap error:%d \n", errno);
+    }
+    if (singleMmap)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ringfd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            LOG_FATAL("io_uring cq ring mmap error:%d \n", errno);
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringfd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        LOG_FATAL("io_uring sqes mmap error:%d \n", errno);
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqLocalTail_ = *sqTail_;
+
+    char *cq = static_cast<char *>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    if (!setupBufferRing())
+    {
+        LOG_INFO("io_uring without multishot recv, channels stay in readiness mode\n");
+    }
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    ::munmap(sqes_, sqesSize_);
+    if (cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    ::munmap(sqRing_, sqRingSize_);
+    ::close(ringfd_);
+    if (bufRing_)
+    {
+        ::munmap(bufRing_, bufRingSize_);
+        ::munmap(buffers_, static_cast<size_t>(kBufferCount) * kBufferSize);
+    }
+}
+
+/**
+ * Completion mode needs provided buffer rings (5.19) and multishot recv (6.0).
+ * Multishot recv can't be probed for, IORING_OP_SEND_ZC came in the same release.
+ */
+bool IoUringPoller::setupBufferRing()
+{
+    std::vector<char> probeStorage(sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op), 0);
+    io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(probeStorage.data());
+    if (ioUringRegister(ringfd_, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0 ||
+        probe->last_op < IORING_OP_SEND_ZC ||
+        !(probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED))
+    {
+        return false;
+    }
+
+    const size_t ringSize = kBufferCount * sizeof(io_uring_buf);
+    const size_t buffersSize = static_cast<size_t>(kBufferCount) * kBufferSize;
+    void *ring = ::mmap(nullptr, ringSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (ring == MAP_FAILED)
+    {
+        return false;
+    }
+    void *buffers = ::mmap(nullptr, buffersSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED)
+    {
+        ::munmap(ring, ringSize);
+        return false;
+    }
+
+    io_uring_buf_reg reg;
+    ::memset(&reg, 0, sizeof reg);
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = kBufferCount;
+    reg.bgid = kBufferGroup;
+    if (ioUringRegister(ringfd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        LOG_ERROR("io_uring register buffer ring error:%d \n", errno);
+        ::munmap(buffers, buffersSize);
+        ::munmap(ring, ringSize);
+        return false;
+    }
+
+    bufRing_ = static_cast<io_uring_buf_ring *>(ring);
+    bufRingSize_ = ringSize;
+    buffers_ = static_cast<char *>(buffers);
+    for (unsigned bid = 0; bid < kBufferCount; ++bid)
+    {
+        usedBuffers_.push_back(static_cast<uint16_t>(bid));
+    }
+    recycleBuffers();
+    return true;
+}
+
+// hand the buffers given out by the last poll() back to the kernel
+void IoUringPoller::recycleBuffers()
+{
+    if (usedBuffers_.empty())
+    {
+        return;
+    }
+    // not bufRing_->bufs: in C++ the header's flexible array wrapper shifts it by 8 bytes
+    io_uring_buf *bufs = reinterpret_cast<io_uring_buf *>(bufRing_);
+    const unsigned mask = kBufferCount - 1;
+    for (uint16_t bid : usedBuffers_)
+    {
+        // only addr/len/bid: the resv field of entry 0 is the ring's tail
+        io_uring_buf *buf = &bufs[bufLocalTail_ & mask];
+        buf->addr = reinterpret_cast<uint64_t>(buffers_ + static_cast<size_t>(bid) * kBufferSize);
+        buf->len = kBufferSize;
+        buf->bid = bid;
+        ++bufLocalTail_;
+    }
+    usedBuffers_.clear();
+    __atomic_store_n(&bufRing_->tail, bufLocalTail_, __ATOMIC_RELEASE);
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    // the channels have copied what they received, so the buffers can be reused
+    if (bufRing_)
+    {
+        recycleBuffers();
+    }
+    // re-arm the one-shot polls that fired last time and the multishot
+    // requests that ended, as far as they are still wanted
+    for (int fd : rearm_)
+    {
+        Registration &reg = registrations_[fd];
+        if (reg.channel && reg.channel->index() == kAdded)
+        {
+            sync(fd, reg);
+        }
+    }
+    rearm_.clear();
+
+    // completions left from a full batch are reaped without waiting
+    bool ready = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_;
+    int ret = 0;
+    int savedErrno = 0;
+    if (toSubmit_ > 0 || !ready)
+    {
+        ret = enter(toSubmit_, ready ? 0 : 1, timeoutMs);
+        savedErrno = errno;
+    }
+    Timestamp now(Timestamp::now());
+
+    fillActiveChannels(activeChannels);
+    if (activeChannels->empty())
+    {
+        LOG_DEBUG("%s: nothing happened \n", __FUNCTION__);
+    }
+    if (ret < 0 && savedErrno != EINTR && savedErrno != ETIME)
+    {
+        LOG_ERROR("IoUringPoller::poll() error:%d \n", savedErrno);
+    }
+    return now;
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    const int index = channel->index();
+    const int fd = channel->fd();
+    Registration &reg = registration(fd);
+    if (index == kNew || index == kDeleted)
+    {
+        if (index == kNew)
+        {
+            channels_[fd] = channel;
+        }
+        channel->setIndex(kAdded);
+        reg.channel = channel;
+        sync(fd, reg);
+    }
+    else if (channel->isNoneEvent())
+    {
+        disarmPoll(reg);
+        disarmOp(reg);
+        channel->setIndex(kDeleted);
+    }
+    else
+    {
+        sync(fd, reg);
+    }
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    const int fd = channel->fd();
+    channels_.erase(fd);
+
+    Registration &reg = registration(fd);
+    if (channel->index() == kAdded)
+    {
+        disarmPoll(reg);
+        disarmOp(reg);
+    }
+    reg.channel = nullptr;
+    channel->setIndex(kNew);
+}
+
+IoUringPoller::Registration &IoUringPoller::registration(int fd)
+{
+    if (static_cast<size_t>(fd) >= registrations_.size())
+    {
+        Registration empty = {nullptr, 0, 0, 0, 0, false, false, 0};
+        registrations_.resize(std::max(registrations_.size() * 2, static_cast<size_t>(fd) + 1), empty);
+    }
+    return registrations_[fd];
+}
+
+/**
+ * Bring the requests in flight for fd in line with its Channel's interest:
+ * a poll for what is reported as readiness, plus the multishot recv or
+ * accept while a channel in completion mode reads.
+ */
+void IoUringPoller::sync(int fd, Registration &reg)
+{
+    Channel *channel = reg.channel;
+    uint32_t pollEvents = static_cast<uint32_t>(channel->events());
+    bool wantOp = false;
+    if (channel->completionMode() != Channel::kReadiness && supportsCompletions())
+    {
+        wantOp = channel->isReading();
+        pollEvents &= ~static_cast<uint32_t>(EPOLLIN | EPOLLPRI | EPOLLEXCLUSIVE);
+    }
+
+    // io_uring has no MOD, cancel the old poll and queue one with the new mask
+    if (reg.pollArmed && reg.pollEvents != pollEvents)
+    {
+        disarmPoll(reg);
+    }
+    if (!reg.pollArmed && pollEvents != 0)
+    {
+        armPoll(fd, reg, pollEvents);
+    }
+    if (reg.opArmed && !wantOp)
+    {
+        disarmOp(reg);
+    }
+    if (!reg.opArmed && wantOp)
+    {
+        armOp(fd, reg);
+    }
+}
+
+void IoUringPoller::armPoll(int fd, Registration &reg, uint32_t events)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    reg.pollToken = makeToken(fd, kPollOp, ++reg.generation);
+    sqe->user_data = reg.pollToken;
+    reg.pollEvents = events;
+    reg.pollArmed = true;
+}
+
+// anything still in flight for the old token is ignored from now on
+void IoUringPoller::disarmPoll(Registration &reg)
+{
+    if (reg.pollArmed)
+    {
+        io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = reg.pollToken;
+        sqe->user_data = kRemoveTag;
+        reg.pollArmed = false;
+    }
+}
+
+void IoUringPoller::armOp(int fd, Registration &reg)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->fd = fd;
+    if (reg.channel->completionMode() == Channel::kAcceptCompletion)
+    {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        reg.opToken = makeToken(fd, kAcceptOp, ++reg.generation);
+    }
+    else
+    {
+        // len 0: each completion fills at most one whole provided buffer
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kBufferGroup;
+        reg.opToken = makeToken(fd, kRecvOp, ++reg.generation);
+    }
+    sqe->user_data = reg.opToken;
+    reg.opArmed = true;
+}
+
+void IoUringPoller::disarmOp(Registration &reg)
+{
+    if (reg.opArmed)
+    {
+        io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = reg.opToken;
+        sqe->user_data = kRemoveTag;
+        reg.opArmed = false;
+    }
+}
+
+// a channel goes into activeChannels once per poll(), whatever completed for it
+void IoUringPoller::report(Registration &reg, int revents, ChannelList *activeChannels)
+{
+    if (reg.round != round_)
+    {
+        reg.round = round_;
+        reg.channel->set_revents(revents);
+        activeChannels->push_back(reg.channel);
+    }
+    else
+    {
+        reg.channel->set_revents(reg.channel->revents() | revents);
+    }
+}
+
+io_uring_sqe *IoUringPoller::getSqe()
+{
+    const unsigned entries = *sqMask_ + 1;
+    if (sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= entries)
+    {
+        // submission queue is full, push it to the kernel without waiting
+        enter(toSubmit_, 0, 0);
+    }
+    const unsigned idx = sqLocalTail_ & *sqMask_;
+    io_uring_sqe *sqe = &sqes_[idx];
+    ::memset(sqe, 0, sizeof *sqe);
+    sqArray_[idx] = idx;
+    ++sqLocalTail_;
+    ++toSubmit_;
+    return sqe;
+}
+
+int IoUringPoller::enter(unsigned toSubmit, unsigned minComplete, int timeoutMs)
+{
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+
+    unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    if (minComplete > 0 && timeoutMs >= 0)
+    {
+        __kernel_timespec ts;
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+        io_uring_getevents_arg arg;
+        ::memset(&arg, 0, sizeof arg);
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        ret = static_cast<int>(::syscall(__NR_io_uring_enter, ringfd_, toSubmit, minComplete,
+                                         flags | IORING_ENTER_EXT_ARG, &arg, sizeof arg));
+    }
+    else
+    {
+        ret = static_cast<int>(::syscall(__NR_io_uring_enter, ringfd_, toSubmit, minComplete,
+                                         flags, nullptr, _NSIG / 8));
+    }
+    int savedErrno = errno;
+    toSubmit_ = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    errno = savedErrno;
+    return ret;
+}
+
+void IoUringPoller::fillActiveChannels(ChannelList *activeChannels)
+{
+    ++round_;
+    unsigned head = *cqHead_;
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe *cqe = &cqes_[head & *cqMask_];
+        if (cqe->user_data == kRemoveTag)
+        {
+            continue;
+        }
+        const int fd = static_cast<int>(cqe->user_data >> 32);
+        const int op = static_cast<int>((cqe->user_data >> 30) & 3);
+        const bool hasBuffer = cqe->flags & IORING_CQE_F_BUFFER;
+        const uint16_t bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        if (hasBuffer)
+        {
+            usedBuffers_.push_back(bid); // back to the ring in the next poll()
+        }
+        Registration *reg = static_cast<size_t>(fd) < registrations_.size() ? &registrations_[fd] : nullptr;
+
+        if (op == kPollOp)
+        {
+            if (!reg || !reg->channel || !reg->pollArmed || reg->pollToken != cqe->user_data)
+            {
+                continue; // completion of a poll we already cancelled
+            }
+            reg->pollArmed = false;
+            rearm_.push_back(fd);
+            if (cqe->res == -ECANCELED)
+            {
+                continue;
+            }
+            report(*reg, cqe->res < 0 ? static_cast<int>(EPOLLERR) : cqe->res, activeChannels);
+            continue;
+        }
+
+        if (!reg || !reg->channel || !reg->opArmed || reg->opToken != cqe->user_data)
+        {
+            if (op == kAcceptOp && cqe->res >= 0)
+            {
+                ::close(cqe->res); // accepted while the channel was being cancelled
+            }
+            continue;
+        }
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+        {
+            // the multishot request ended, e.g. on an error or out of buffers
+            reg->opArmed = false;
+            rearm_.push_back(fd);
+        }
+        if (cqe->res == -ENOBUFS || cqe->res == -ECANCELED)
+        {
+            continue; // re-armed once the buffers are back
+        }
+        const char *data = hasBuffer ? buffers_ + static_cast<size_t>(bid) * kBufferSize : nullptr;
+        reg->channel->addCompletion(cqe->res, data);
+        report(*reg, 0, activeChannels);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,98 @@
+#include "LengthHeaderCodec.h"
+#include "Buffer.h"
+#include "Logger.h"
+#include "TcpConnection.h"
+
+LengthHeaderCodec::LengthHeaderCodec(const FrameCallback &cb, size_t headerLen, size_t maxFrameSize)
+    : frameCallback_(cb),
+      headerLen_(headerLen),
+      maxFrameSize_(maxFrameSize)
+{
+    if (headerLen_ != 1 && headerLen_ != 2 && headerLen_ != 4 && headerLen_ != 8)
+    {
+        LOG_FATAL("LengthHeaderCodec: header length %lu is not 1, 2, 4 or 8\n", (unsigned long)headerLen_);
+    }
+}
+
+uint64_t LengthHeaderCodec::peekHeader(const Buffer *buf) const
+{
+    switch (headerLen_)
+    {
+    case 1:
+        return static_cast<uint8_t>(buf->peekInt8());
+    case 2:
+        return static_cast<uint16_t>(buf->peekInt16());
+    case 4:
+        return static_cast<uint32_t>(buf->peekInt32());
+    default:
+        return static_cast<uint64_t>(buf->peekInt64());
+    }
+}
+
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    while (buf->readableBytes() >= headerLen_)
+    {
+        uint64_t len = peekHeader(buf);
+        if (len > maxFrameSize_)
+        {
+            LOG_ERROR("LengthHeaderCodec: %s sent a %llu byte frame, limit %lu\n",
+                      conn->name().c_str(), (unsigned long long)len, (unsigned long)maxFrameSize_);
+            buf->retrieveAll();
+            conn->forceClose();
+            break;
+        }
+        if (buf->readableBytes() < headerLen_ + len)
+        {
+            break; // the rest of the frame is still in flight
+        }
+        buf->retrieve(headerLen_);
+        frameCallback_(conn, buf->peek(), static_cast<size_t>(len), receiveTime);
+        buf->retrieve(static_cast<size_t>(len));
+    }
+}
+
+bool LengthHeaderCodec::encode(Buffer *buf) const
+{
+    size_t len = buf->readableBytes();
+    if (len > maxFrameSize_ || (headerLen_ < 8 && (static_cast<uint64_t>(len) >> (headerLen_ * 8)) != 0))
+    {
+        LOG_ERROR("LengthHeaderCodec: %lu byte frame does not fit\n", (unsigned long)len);
+        return false;
+    }
+    switch (headerLen_)
+    {
+    case 1:
+        buf->prependInt8(static_cast<int8_t>(len));
+        break;
+    case 2:
+        buf->prependInt16(static_cast<int16_t>(len));
+        break;
+    case 4:
+        buf->prependInt32(static_cast<int32_t>(len));
+        break;
+    default:
+        buf->prependInt64(static_cast<int64_t>(len));
+        break;
+    }
+    return true;
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, const char *data, size_t len) const
+{
+    Buffer buf(len);
+    buf.append(data, len);
+    send(conn, &buf);
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, Buffer *buf) const
+{
+    if (encode(buf))
+    {
+        conn->send(buf);
+    }
+    else
+    {
+        buf->retrieveAll();
+    }
+}
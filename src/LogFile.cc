@@ -0,0 +1,86 @@
+#include <stdio.h>
+
+#include "LogFile.h"
+
+LogFile::LogFile(const std::string &basename, off_t rollSize)
+    : basename_(basename),
+      rollSize_(rollSize),
+      fp_(nullptr),
+      writtenBytes_(0),
+      startOfPeriod_(0),
+      lastRoll_(0)
+{
+    rollFile();
+}
+
+LogFile::~LogFile()
+{
+    if (fp_)
+    {
+        ::fclose(fp_);
+    }
+}
+
+void LogFile::append(const char *logline, size_t len)
+{
+    if (!fp_)
+    {
+        return;
+    }
+    // the backend is the only writer, skip stdio's internal locking
+    size_t written = ::fwrite_unlocked(logline, 1, len, fp_);
+    writtenBytes_ += written;
+
+    if (writtenBytes_ > rollSize_)
+    {
+        rollFile();
+    }
+    else
+    {
+        time_t now = ::time(NULL);
+        if (now / kRollPerSeconds * kRollPerSeconds != startOfPeriod_)
+        {
+            rollFile();
+        }
+    }
+}
+
+void LogFile::flush()
+{
+    if (fp_)
+    {
+        ::fflush(fp_);
+    }
+}
+
+void LogFile::rollFile()
+{
+    time_t now = ::time(NULL);
+    if (fp_ && now == lastRoll_)
+    {
+        return; // at most one file per second, the name has second resolution
+    }
+
+    char timebuf[32];
+    struct tm tm;
+    ::localtime_r(&now, &tm);
+    ::strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.log", &tm);
+    std::string filename = basename_ + timebuf;
+
+    if (fp_)
+    {
+        ::fclose(fp_);
+    }
+    fp_ = ::fopen(filename.c_str(), "ae");
+    if (fp_)
+    {
+        ::setvbuf(fp_, buffer_, _IOFBF, sizeof buffer_);
+    }
+    else
+    {
+        ::fprintf(stderr, "LogFile::rollFile open %s failed\n", filename.c_str());
+    }
+    writtenBytes_ = 0;
+    lastRoll_ = now;
+    startOfPeriod_ = now / kRollPerSeconds * kRollPerSeconds;
+}
@@ -1,39 +1,95 @@
+#include <string.h>
+#include <time.h>
+
 #include "Logger.h"
 #include "Timestamp.h"
 
-// fetch the only instance object of the log singleton
-Logger &Logger::instance()
+int Logger::logLevel_ = MUDUO_LOG_MIN_LEVEL > INFO ? MUDUO_LOG_MIN_LEVEL : INFO;
+
+static void defaultOutput(const char *msg, size_t len)
 {
-    static Logger logger;
-    return logger;
+    ::fwrite(msg, 1, len, stdout);
 }
 
-// set log level
-void Logger::setLogLevel(int level)
+static void defaultFlush()
 {
-    logLevel_ = level;
+    ::fflush(stdout);
 }
 
-// write log
-void Logger::log(std::string msg)
+static Logger::OutputFunc g_output = defaultOutput;
+static Logger::FlushFunc g_flush = defaultFlush;
+
+// formatting the date is the expensive part, do it once per second per thread
+__thread time_t t_lastSecond = 0;
+__thread char t_time[32];
+
+static const char *levelName(int level)
 {
-    std::string pre = "";
-    switch (logLevel_)
+    switch (level)
     {
     case INFO:
-        pre = "[INFO] ";
-        break;
+        return "[INFO] ";
     case ERROR:
-        pre = "[ERROR] ";
-        break;
+        return "[ERROR] ";
     case FATAL:
-        pre = "[FATAL] ";
-        break;
+        return "[FATAL] ";
     case DEBUG:
-        pre = "[DEBUG] ";
-        break;
+        return "[DEBUG] ";
     default:
-        break;
+        return "";
+    }
+}
+
+// fetch the only instance object of the log singleton
+Logger &Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+void Logger::setOutput(OutputFunc out)
+{
+    g_output = out;
+}
+
+void Logger::setFlush(FlushFunc flush)
+{
+    g_flush = flush;
+}
+
+// write log
+void Logger::log(int level, const char *msg, int len)
+{
+    time_t seconds = Timestamp::now().secondsSinceEpoch();
+    if (seconds != t_lastSecond)
+    {
+        t_lastSecond = seconds;
+        ::strncpy(t_time, Timestamp(static_cast<int64_t>(seconds) * Timestamp::kMicroSecondsPerSecond).toString().c_str(),
+                  sizeof t_time - 1);
+    }
+
+    if (len < 0)
+    {
+        len = 0;
+    }
+    else if (len > 1023)
+    {
+        len = 1023; // snprintf truncated the message
+    }
+
+    // "[LEVEL] date : msg\n", one line per call
+    char line[1100];
+    int n = snprintf(line, sizeof line, "%s%s : ", levelName(level), t_time);
+    ::memcpy(line + n, msg, len);
+    n += len;
+    if (len == 0 || msg[len - 1] != '\n')
+    {
+        line[n++] = '\n';
     }
-    std::cout << pre + Timestamp::now().toString() + " : " + msg << std::endl;
-}
\ No newline at end of file
+    g_output(line, n);
+
+    if (level >= ERROR)
+    {
+        g_flush();
+    }
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "LoopMetrics.h"
+
+static void copyBuckets(uint64_t (&to)[LoopMetrics::kNumBuckets], const LoopMetrics::Histogram &from)
+{
+    for (int i = 0; i < LoopMetrics::kNumBuckets; ++i)
+    {
+        to[i] = from.bucket(i);
+    }
+}
+
+static void addBuckets(uint64_t (&to)[LoopMetrics::kNumBuckets], const uint64_t (&from)[LoopMetrics::kNumBuckets])
+{
+    for (int i = 0; i < LoopMetrics::kNumBuckets; ++i)
+    {
+        to[i] += from[i];
+    }
+}
+
+LoopMetrics::Snapshot::Snapshot()
+    : iterations(0),
+      functorsRun(0),
+      bytesRead(0),
+      bytesWritten(0),
+      connectionsOpened(0),
+      connectionsClosed(0)
+{
+    ::memset(pollWaitUs, 0, sizeof pollWaitUs);
+    ::memset(processingUs, 0, sizeof processingUs);
+    ::memset(activeChannels, 0, sizeof activeChannels);
+    ::memset(pendingFunctors, 0, sizeof pendingFunctors);
+}
+
+LoopMetrics::Snapshot &LoopMetrics::Snapshot::operator+=(const Snapshot &rhs)
+{
+    iterations += rhs.iterations;
+    functorsRun += rhs.functorsRun;
+    bytesRead += rhs.bytesRead;
+    bytesWritten += rhs.bytesWritten;
+    connectionsOpened += rhs.connectionsOpened;
+    connectionsClosed += rhs.connectionsClosed;
+    addBuckets(pollWaitUs, rhs.pollWaitUs);
+    addBuckets(processingUs, rhs.processingUs);
+    addBuckets(activeChannels, rhs.activeChannels);
+    addBuckets(pendingFunctors, rhs.pendingFunctors);
+    return *this;
+}
+
+uint64_t LoopMetrics::Snapshot::percentile(const uint64_t (&buckets)[kNumBuckets], double q)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        total += buckets[i];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * total);
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        seen += buckets[i];
+        if (seen > rank || seen == total)
+        {
+            return i == 0 ? 0 : (1ULL << i) - 1;
+        }
+    }
+    return (1ULL << (kNumBuckets - 1)) - 1;
+}
+
+std::string LoopMetrics::Snapshot::toString() const
+{
+    char buf[512];
+    snprintf(buf, sizeof buf,
+             "iterations=%llu functors=%llu bytesRead=%llu bytesWritten=%llu "
+             "connOpened=%llu connClosed=%llu "
+             "pollWaitUs(p50/p99)=%llu/%llu processingUs(p50/p99)=%llu/%llu "
+             "activeChannels(p50/p99)=%llu/%llu pendingFunctors(p99)=%llu",
+             (unsigned long long)iterations, (unsigned long long)functorsRun,
+             (unsigned long long)bytesRead, (unsigned long long)bytesWritten,
+             (unsigned long long)connectionsOpened, (unsigned long long)connectionsClosed,
+             (unsigned long long)percentile(pollWaitUs, 0.5), (unsigned long long)percentile(pollWaitUs, 0.99),
+             (unsigned long long)percentile(processingUs, 0.5), (unsigned long long)percentile(processingUs, 0.99),
+             (unsigned long long)percentile(activeChannels, 0.5), (unsigned long long)percentile(activeChannels, 0.99),
+             (unsigned long long)percentile(pendingFunctors, 0.99));
+    return buf;
+}
+
+LoopMetrics::Snapshot LoopMetrics::snapshot() const
+{
+    Snapshot s;
+    s.iterations = iterations.value();
+    s.functorsRun = functorsRun.value();
+    s.bytesRead = bytesRead.value();
+    s.bytesWritten = bytesWritten.value();
+    s.connectionsOpened = connectionsOpened.value();
+    s.connectionsClosed = connectionsClosed.value();
+    copyBuckets(s.pollWaitUs, pollWaitUs);
+    copyBuckets(s.processingUs, processingUs);
+    copyBuckets(s.activeChannels, activeChannels);
+    copyBuckets(s.pendingFunctors, pendingFunctors);
+    return s;
+}
@@ -0,0 +1,211 @@
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "SegmentedBuffer.h"
+
+SegmentedBuffer::SegmentedBuffer(BlockPool *pool)
+    : readable_(0),
+      pool_(pool)
+{
+}
+
+SegmentedBuffer::~SegmentedBuffer()
+{
+    retrieveAll();
+}
+
+SegmentedBuffer::Block SegmentedBuffer::newBlock(size_t capacity)
+{
+    Block block;
+    if (capacity <= BlockPool::kBlockSize)
+    {
+        capacity = BlockPool::kBlockSize;
+        block.data = pool_ ? pool_->allocate() : new char[capacity];
+    }
+    else
+    {
+        block.data = new char[capacity];
+    }
+    block.capacity = capacity;
+    block.readerIndex = 0;
+    block.writerIndex = 0;
+    return block;
+}
+
+void SegmentedBuffer::freeBlock(const Block &block)
+{
+    if (block.pin)
+    {
+        return; // not ours, dropping the Block drops our reference
+    }
+    if (pool_ && block.capacity == BlockPool::kBlockSize)
+    {
+        pool_->deallocate(block.data);
+    }
+    else
+    {
+        delete[] block.data;
+    }
+}
+
+void SegmentedBuffer::append(const char *data, size_t len)
+{
+    readable_ += len;
+    while (len > 0)
+    {
+        if (blocks_.empty() || blocks_.back().writerIndex == blocks_.back().capacity)
+        {
+            blocks_.push_back(newBlock(BlockPool::kBlockSize));
+        }
+        Block &tail = blocks_.back();
+        size_t n = std::min(len, tail.capacity - tail.writerIndex);
+        ::memcpy(tail.data + tail.writerIndex, data, n);
+        tail.writerIndex += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void SegmentedBuffer::appendPinned(const char *data, size_t len, const std::shared_ptr<const void> &pin)
+{
+    Block block;
+    block.data = const_cast<char *>(data);
+    block.capacity = len; // full, so append() never writes into it
+    block.readerIndex = 0;
+    block.writerIndex = len;
+    block.pin = pin;
+    blocks_.push_back(block);
+    readable_ += len;
+}
+
+const char *SegmentedBuffer::peek()
+{
+    if (blocks_.empty())
+    {
+        return nullptr;
+    }
+    if (blocks_.size() > 1)
+    {
+        // gather everything into a single block so callers get a contiguous view
+        Block whole = newBlock(readable_);
+        for (const Block &block : blocks_)
+        {
+            size_t n = block.writerIndex - block.readerIndex;
+            ::memcpy(whole.data + whole.writerIndex, block.data + block.readerIndex, n);
+            whole.writerIndex += n;
+            freeBlock(block);
+        }
+        blocks_.clear();
+        blocks_.push_back(whole);
+    }
+    const Block &front = blocks_.front();
+    return front.data + front.readerIndex;
+}
+
+void SegmentedBuffer::retrieve(size_t len)
+{
+    if (len >= readable_)
+    {
+        retrieveAll();
+        return;
+    }
+    readable_ -= len;
+    while (len > 0)
+    {
+        Block &front = blocks_.front();
+        size_t n = std::min(len, front.writerIndex - front.readerIndex);
+        front.readerIndex += n;
+        len -= n;
+        if (front.readerIndex == front.writerIndex)
+        {
+            freeBlock(front);
+            blocks_.pop_front();
+        }
+    }
+}
+
+void SegmentedBuffer::retrieveAll()
+{
+    for (const Block &block : blocks_)
+    {
+        freeBlock(block);
+    }
+    blocks_.clear();
+    readable_ = 0;
+}
+
+std::string SegmentedBuffer::retrieveAllAsString()
+{
+    std::string result;
+    result.reserve(readable_);
+    for (const Block &block : blocks_)
+    {
+        result.append(block.data + block.readerIndex, block.writerIndex - block.readerIndex);
+    }
+    retrieveAll();
+    return result;
+}
+
+void SegmentedBuffer::swap(SegmentedBuffer &rhs)
+{
+    blocks_.swap(rhs.blocks_);
+    std::swap(readable_, rhs.readable_);
+    std::swap(pool_, rhs.pool_);
+}
+
+ssize_t SegmentedBuffer::writeFd(int fd, int *saveErrno, std::shared_ptr<const void> *zeroCopyPin)
+{
+    ssize_t n;
+    if (!blocks_.empty() && blocks_.front().pin)
+    {
+        const Block &front = blocks_.front();
+        struct iovec vec;
+        vec.iov_base = front.data + front.readerIndex;
+        vec.iov_len = front.writerIndex - front.readerIndex;
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof msg);
+        msg.msg_iov = &vec;
+        msg.msg_iovlen = 1;
+        n = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+        if (n >= 0)
+        {
+            if (zeroCopyPin)
+            {
+                *zeroCopyPin = front.pin;
+            }
+            return n;
+        }
+        if (errno == ENOBUFS)
+        {
+            // out of optmem for pinned pages, copy this chunk instead of spinning
+            n = ::write(fd, vec.iov_base, vec.iov_len);
+        }
+    }
+    else
+    {
+        // gather the plain blocks up to the next pinned one
+        struct iovec vec[IOV_MAX];
+        int iovcnt = 0;
+        for (const Block &block : blocks_)
+        {
+            if (iovcnt == IOV_MAX || block.pin)
+            {
+                break;
+            }
+            vec[iovcnt].iov_base = block.data + block.readerIndex;
+            vec[iovcnt].iov_len = block.writerIndex - block.readerIndex;
+            ++iovcnt;
+        }
+        n = ::writev(fd, vec, iovcnt);
+    }
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
@@ -98,4 +98,35 @@ void Socket::setKeepAlive(bool on)
      */
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
-}
\ No newline at end of file
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+    /**
+     * SO_ZEROCOPY allows send(MSG_ZEROCOPY) to transmit straight from user pages.
+     * The pages must stay untouched until the completion shows up on the
+     * socket error queue.
+     */
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof optval) == 0;
+}
+
+bool Socket::setBusyPoll(int microSeconds)
+{
+    /**
+     * SO_BUSY_POLL makes a blocking read or poll on this socket spin on the
+     * device queue for up to microSeconds before sleeping, needs a NIC driver
+     * with NAPI busy polling. SO_PREFER_BUSY_POLL (5.11) also keeps softirq
+     * processing from competing with it.
+     */
+    int optval = microSeconds;
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &optval, sizeof optval) < 0)
+    {
+        return false;
+    }
+#ifdef SO_PREFER_BUSY_POLL
+    optval = microSeconds > 0 ? 1 : 0;
+    ::setsockopt(sockfd_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &optval, sizeof optval);
+#endif
+    return true;
+}
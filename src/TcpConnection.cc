@@ -5,6 +5,8 @@
 #include <sys/socket.h>
 #include <string.h>
 #include <netinet/tcp.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
 #include <sys/sendfile.h>
 #include <fcntl.h>  // for open
 #include <unistd.h> // for close
@@ -14,6 +16,59 @@
 #include "Socket.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "BufferPool.h"
+
+// edge-triggered reads per event before yielding to the loop's other channels
+const int kMaxReadsPerEvent = 16;
+// how long a closed connection's zero-copy sends may take to complete
+const double kZeroCopyLingerInterval = 0.01;
+const int kZeroCopyLingerChecks = 100;
+
+/**
+ * Zero-copy sends still in flight when the connection is destroyed. A dup
+ * of the socket keeps it open, so its error queue can still be read, and
+ * the pins are released only once every send completed. If that takes too
+ * long the socket is reset instead: SO_LINGER 0 makes close() drop the
+ * queued data, and with it the kernel's references to the pages.
+ */
+struct TcpConnection::ZeroCopyLinger : noncopyable
+{
+    ZeroCopyLinger(int sockfd, const std::string &connName)
+        : fd(sockfd),
+          name(connName)
+    {
+    }
+    ~ZeroCopyLinger()
+    {
+        if (fd >= 0)
+        {
+            if (!inflight.empty())
+            {
+                LOG_ERROR("TcpConnection::ZeroCopyLinger name:%s - %zu sends unfinished, resetting\n",
+                          name.c_str(), inflight.size());
+                struct linger lg = {1, 0};
+                ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+            }
+            ::close(fd);
+        }
+        // inflight is destroyed after the close
+    }
+
+    const int fd;
+    const std::string name;
+    ZeroCopyPins inflight;
+};
+
+void defaultConnectionCallback(const TcpConnectionPtr &conn)
+{
+    LOG_DEBUG("%s -> %s is %s\n", conn->localAddress().toIpPort().c_str(),
+              conn->peerAddress().toIpPort().c_str(), conn->connected() ? "UP" : "DOWN");
+}
+
+void defaultMessageCallback(const TcpConnectionPtr &, Buffer *buf, Timestamp)
+{
+    buf->retrieveAll();
+}
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
@@ -37,7 +92,13 @@ TcpConnection::TcpConnection(EventLoop *loop,
       channel_(new Channel(loop, sockfd)),
       localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024)
+      highWaterMark_(64 * 1024 * 1024),
+      idleTimeout_(0.0),
+      inputBuffer_(0),
+      inputSizeHint_(BufferPool::kMinClassSize),
+      outputBuffer_(loop->blockPool()),
+      zeroCopyThreshold_(0),
+      zeroCopyNextSeq_(0)
 {
     channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
     channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
@@ -46,11 +107,14 @@ TcpConnection::TcpConnection(EventLoop *loop,
 
     LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
     socket_->setKeepAlive(true);
+    // counted from here, not connectEstablished, so a burst of accepts already sees it
+    loop_->connectionAdded();
 }
 
 TcpConnection::~TcpConnection()
 {
     LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d\n", name_.c_str(), channel_->fd(), (int)state_);
+    loop_->connectionRemoved();
 }
 
 /**
@@ -58,6 +122,27 @@ TcpConnection::~TcpConnection()
  * layer to call for sending TCP data.
  */
 void TcpConnection::send(const std::string &buf)
+{
+    send(buf.data(), buf.size());
+}
+
+void TcpConnection::send(std::string &&buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(buf.data(), buf.size());
+        }
+        else
+        {
+            // the string is moved into the functor, the caller's copy may die right away
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::move(buf)));
+        }
+    }
+}
+
+void TcpConnection::send(const void *data, size_t len)
 {
     if (state_ == kConnected)
     {
@@ -68,21 +153,134 @@ void TcpConnection::send(const std::string &buf)
         if (loop_->isInLoopThread())
         {
             // if true, directly call sendInLoop to send data syncronously
-            sendInLoop(buf.c_str(), buf.size());
+            sendInLoop(data, len);
         }
         else
         {
             /**
              * else, it indicates a "cross-thread" call, and dispatch the sending task
              * to the EventLoop thread by runInLoop, ensuring thread safely.
+             * The caller's memory may be gone by then, so it is copied once.
              */
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+            std::string message(static_cast<const char *>(data), len);
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::move(message)));
         }
     }
 }
 
-void TcpConnection::sendFile(int fd, off_t *offset, size_t count)
+void TcpConnection::send(Buffer *buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else
+        {
+            // swap the storage out instead of copying it
+            std::shared_ptr<Buffer> message(new Buffer(0));
+            message->swap(*buf);
+            loop_->runInLoop(std::bind(&TcpConnection::sendBufferInLoop, shared_from_this(), message));
+        }
+    }
+}
+
+void TcpConnection::sendStringInLoop(const std::string &message)
+{
+    sendInLoop(message.data(), message.size());
+}
+
+void TcpConnection::sendBufferInLoop(const std::shared_ptr<Buffer> &message)
+{
+    sendInLoop(message->peek(), message->readableBytes());
+}
+
+void TcpConnection::setEdgeTriggered(bool on)
+{
+    channel_->setEdgeTriggered(on && loop_->supportsEdgeTriggered());
+}
+
+bool TcpConnection::setSocketBusyPoll(int microSeconds)
+{
+    return socket_->setBusyPoll(microSeconds);
+}
+
+void TcpConnection::sendZeroCopy(const void *data, size_t len, const std::shared_ptr<const void> &pin)
+{
+    if (state_ == kConnected)
+    {
+        // the pin keeps the memory valid, so the cross-thread path needs no copy either
+        loop_->runInLoop(std::bind(&TcpConnection::sendZeroCopyInLoop, shared_from_this(), data, len, pin));
+    }
+}
+
+void TcpConnection::sendZeroCopy(const std::shared_ptr<const std::string> &message)
+{
+    sendZeroCopy(message->data(), message->size(), message);
+}
+
+void TcpConnection::setZeroCopyThreshold(size_t bytes)
 {
+    loop_->runInLoop(std::bind(&TcpConnection::setZeroCopyThresholdInLoop, shared_from_this(), bytes));
+}
+
+void TcpConnection::setZeroCopyThresholdInLoop(size_t bytes)
+{
+    if (bytes > 0 && zeroCopyThreshold_ == 0 && !socket_->setZeroCopy(true))
+    {
+        LOG_ERROR("TcpConnection::setZeroCopyThreshold name:%s - SO_ZEROCOPY unsupported\n", name_.c_str());
+        return;
+    }
+    // once SO_ZEROCOPY is on it stays on, 0 only stops new zero-copy sends
+    zeroCopyThreshold_ = bytes;
+}
+
+void TcpConnection::sendZeroCopyInLoop(const void *data, size_t len, const std::shared_ptr<const void> &pin)
+{
+    // page pinning and the completion round trip cost more than copying small writes
+    if (zeroCopyThreshold_ == 0 || len < zeroCopyThreshold_)
+    {
+        sendInLoop(data, len);
+        return;
+    }
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing");
+        return;
+    }
+
+    size_t oldLen = outputBuffer_.readableBytes();
+    if (oldLen + len >= highWaterMark_ &&
+        oldLen < highWaterMark_ &&
+        highWaterMarkCallback_)
+    {
+        loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + len));
+    }
+    SegmentedBuffer &output = pendingFiles_.empty() ? outputBuffer_ : pendingFiles_.back().trailing;
+    output.appendPinned(static_cast<const char *>(data), len, pin);
+    if (!channel_->isWriting())
+    {
+        // nothing was queued ahead, try right away instead of waiting for EPOLLOUT
+        channel_->enableWriting();
+        handleWrite();
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t count)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendFileInLoop(fd, offset, count);
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fd, offset, count));
+        }
+    }
 }
 
 // shutdown the write side of the connection
@@ -95,17 +293,75 @@ void TcpConnection::shutdown()
     }
 }
 
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();
+    }
+}
+
+void TcpConnection::setIdleTimeout(double seconds)
+{
+    loop_->runInLoop(std::bind(&TcpConnection::setIdleTimeoutInLoop, shared_from_this(), seconds));
+}
+
+void TcpConnection::setIdleTimeoutInLoop(double seconds)
+{
+    idleTimeout_ = seconds;
+    TimingWheel *wheel = loop_->timingWheel();
+    if (seconds > 0 && state_ == kConnected)
+    {
+        std::weak_ptr<TcpConnection> weakConn(shared_from_this());
+        wheel->add(&idleNode_, seconds, [weakConn]()
+                   {
+                       TcpConnectionPtr conn = weakConn.lock();
+                       if (conn)
+                       {
+                           conn->handleIdleTimeout();
+                       }
+                   });
+    }
+    else
+    {
+        wheel->remove(&idleNode_);
+    }
+}
+
+void TcpConnection::handleIdleTimeout()
+{
+    LOG_INFO("TcpConnection::handleIdleTimeout [%s] idle for %.1fs\n", name_.c_str(), idleTimeout_);
+    forceCloseInLoop();
+}
+
 void TcpConnection::connectEstablished()
 {
     setState(kConnected);
     channel_->tie(shared_from_this());
+    if (!channel_->isEdgeTriggered() && loop_->supportsCompletions())
+    {
+        channel_->setCompletionMode(Channel::kRecvCompletion,
+                                    std::bind(&TcpConnection::handleReceived, this, std::placeholders::_1,
+                                              std::placeholders::_2, std::placeholders::_3));
+    }
     channel_->enableReading();
+    loop_->metrics().connectionsOpened.add(1);
     // new connection has established, call connection callback
     connectionCallback_(shared_from_this());
 }
 
 void TcpConnection::connectDestroyed()
 {
+    loop_->metrics().connectionsClosed.add(1);
     if (state_ == kConnected)
     {
         setState(kDisconnected);
@@ -113,6 +369,22 @@ void TcpConnection::connectDestroyed()
         channel_->disableAll();
         connectionCallback_(shared_from_this());
     }
+    if (idleNode_.linked())
+    {
+        loop_->timingWheel()->remove(&idleNode_);
+    }
+    // give the blocks back to the loop's pool here, the last reference may drop in another thread
+    outputBuffer_.retrieveAll();
+    pendingFiles_.clear();
+    if (!zeroCopyInflight_.empty())
+    {
+        // the kernel may still be sending from these pages after we close our fd
+        std::shared_ptr<ZeroCopyLinger> linger(new ZeroCopyLinger(::dup(socket_->fd()), name_));
+        linger->inflight.swap(zeroCopyInflight_);
+        lingerZeroCopy(loop_, linger, kZeroCopyLingerChecks);
+    }
+    inputBuffer_.retrieveAll();
+    releaseInputBuffer();
     channel_->remove(); // remove channel from Poller
 }
 
@@ -122,21 +394,133 @@ void TcpConnection::connectDestroyed()
  */
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
-    int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if (n > 0)
+    if (state_ == kDisconnected)
+    {
+        return; // a read continued by kMaxReadsPerEvent, the connection closed meanwhile
+    }
+
+    const bool edgeTriggered = channel_->isEdgeTriggered();
+    for (int reads = 1;; ++reads)
+    {
+        int savedErrno = 0;
+        if (!inputBuffer_.hasStorage())
+        {
+            inputBuffer_.adoptStorage(loop_->bufferPool()->acquire(inputSizeHint_));
+        }
+        size_t space = inputBuffer_.writableBytes();
+        if (space < Buffer::kExtraReadSize)
+        {
+            space += Buffer::kExtraReadSize;
+        }
+        ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+        if (n > 0)
+        {
+            idleNode_.touch();
+            loop_->addBytesRead(n);
+            messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+            releaseInputBuffer();
+            /**
+             * Edge-triggered: no new event comes for what is left in the socket.
+             * A short read means it is empty, data arriving later raises a new edge.
+             */
+            if (!edgeTriggered || static_cast<size_t>(n) < space || state_ == kDisconnected)
+            {
+                break;
+            }
+            if (reads == kMaxReadsPerEvent)
+            {
+                // let the loop's other channels run, then carry on
+                loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), receiveTime));
+                break;
+            }
+        }
+        else if (n == 0)
+        {
+            handleClose();
+            break;
+        }
+        else if (edgeTriggered && savedErrno == EWOULDBLOCK)
+        {
+            releaseInputBuffer();
+            break;
+        }
+        else
+        {
+            errno = savedErrno;
+            LOG_ERROR("TcpConnection::handleRead");
+            handleError();
+            break;
+        }
+    }
+}
+
+/**
+ * Completion mode: the poller's multishot recv already read into its own
+ * buffers, which are only valid until the next poll(). Everything received
+ * in one poll() is copied into inputBuffer_ and delivered with one
+ * messageCallback_, before an end of stream is handled.
+ */
+void TcpConnection::handleReceived(const Channel::Completion *received, size_t count, Timestamp receiveTime)
+{
+    size_t bytes = 0;
+    bool eof = false;
+    for (size_t i = 0; i < count && state_ != kDisconnected; ++i)
+    {
+        int n = received[i].res;
+        if (n > 0)
+        {
+            if (!inputBuffer_.hasStorage())
+            {
+                inputBuffer_.adoptStorage(loop_->bufferPool()->acquire(inputSizeHint_));
+            }
+            inputBuffer_.append(received[i].data, n);
+            bytes += n;
+        }
+        else if (n == 0)
+        {
+            eof = true;
+            break;
+        }
+        else
+        {
+            // recv already took the socket error, SO_ERROR would read 0 now
+            LOG_ERROR("TcpConnection::handleReceived name:%s - err:%d\n", name_.c_str(), -n);
+        }
+    }
+    if (bytes > 0 && state_ != kDisconnected)
     {
+        idleNode_.touch();
+        loop_->addBytesRead(bytes);
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        releaseInputBuffer();
     }
-    else if (n == 0)
+    if (eof && state_ != kDisconnected)
     {
         handleClose();
     }
-    else
+}
+
+/**
+ * Give the input storage back to the pool once the message callback consumed
+ * everything. A partial message stays, but a buffer that once grew for a big
+ * message is shrunk so a long-lived connection does not keep that memory.
+ */
+void TcpConnection::releaseInputBuffer()
+{
+    size_t readable = inputBuffer_.readableBytes();
+    if (readable == 0)
+    {
+        std::vector<char> storage = inputBuffer_.releaseStorage();
+        // what this connection needed, asked for again on the next read
+        if (storage.size() > Buffer::kCheapPrepend)
+        {
+            inputSizeHint_ = storage.size() - Buffer::kCheapPrepend;
+        }
+        loop_->bufferPool()->release(std::move(storage));
+    }
+    else if (inputBuffer_.capacity() > BufferPool::kMaxClassSize && readable < inputBuffer_.capacity() / 4)
     {
-        errno = savedErrno;
-        LOG_ERROR("TcpConnection::handleRead");
-        handleError();
+        inputBuffer_.shrink(0);
     }
 }
 
@@ -149,29 +533,72 @@ void TcpConnection::handleWrite()
     if (channel_->isWriting())
     {
         int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
-        if (n > 0)
+        bool more;
+        do
         {
-            outputBuffer_.retrieve(n);
-            if (outputBuffer_.readableBytes() == 0)
+            if (outputBuffer_.readableBytes() > 0)
             {
-                channel_->disableWriting();
-                if (writeCompleteCallback_)
+                std::shared_ptr<const void> pin;
+                ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno, &pin);
+                if (n > 0)
                 {
-                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                    idleNode_.touch();
+                    loop_->addBytesWritten(n);
+                    if (pin)
+                    {
+                        // the kernel still reads these pages, hold them until the completion
+                        zeroCopyInflight_.push_back(std::make_pair(zeroCopyNextSeq_++, std::move(pin)));
+                    }
+                    outputBuffer_.retrieve(n);
                 }
-                if (state_ == kDisconnecting)
+                else
                 {
-                    shutdownInLoop();
+                    if (savedErrno != EWOULDBLOCK)
+                    {
+                        LOG_ERROR("TcpConnection::handleWrite");
+                    }
+                    return;
                 }
             }
-        }
-        else
+            // the buffered bytes ahead of a file are gone, hand the socket to sendfile
+            while (outputBuffer_.readableBytes() == 0 && !pendingFiles_.empty())
+            {
+                if (!writePendingFile(&savedErrno))
+                {
+                    if (savedErrno == EINTR)
+                    {
+                        savedErrno = 0;
+                        continue;
+                    }
+                    if (savedErrno != 0 && savedErrno != EWOULDBLOCK)
+                    {
+                        // EBADF, EINVAL, EIO... retrying on the next EPOLLOUT would spin forever
+                        LOG_ERROR("TcpConnection::handleWrite sendfile name:%s - errno:%d\n", name_.c_str(), savedErrno);
+                        forceCloseInLoop();
+                        return;
+                    }
+                    break;
+                }
+            }
+            // edge-triggered: the next EPOLLOUT only comes once the socket has been full
+            more = channel_->isEdgeTriggered() && savedErrno == 0 &&
+                   (outputBuffer_.readableBytes() > 0 || !pendingFiles_.empty());
+        } while (more);
+
+        if (outputBuffer_.readableBytes() == 0 && pendingFiles_.empty())
         {
-            LOG_ERROR("TcpConnection::handleWrite");
+            channel_->disableWriting();
+            if (writeCompleteCallback_)
+            {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            if (state_ == kDisconnecting)
+            {
+                shutdownInLoop();
+            }
         }
     }
-    else
+    else if (!channel_->isEdgeTriggered()) // edge-triggered EPOLLOUT also comes with reads
     {
         LOG_ERROR("TcpConnection fd=%d is down, no more writing", channel_->fd());
     }
@@ -186,14 +613,83 @@ void TcpConnection::handleClose()
     LOG_INFO("TcpConnection::handleClose fd=%d state=%d\n", channel_->fd(), (int)state_);
     setState(kDisconnected);
     channel_->disableAll();
+    if (idleNode_.linked())
+    {
+        loop_->timingWheel()->remove(&idleNode_);
+    }
 
     TcpConnectionPtr connPtr(shared_from_this());
     connectionCallback_(connPtr);
     closeCallback_(connPtr);
 }
 
+/**
+ * MSG_ZEROCOPY completions arrive on the socket error queue as ranges
+ * [lo, hi] of send sequence numbers, always in order for TCP.
+ */
+void TcpConnection::lingerZeroCopy(EventLoop *loop, const std::shared_ptr<ZeroCopyLinger> &linger, int checksLeft)
+{
+    if (linger->fd >= 0)
+    {
+        readZeroCopyCompletions(linger->fd, linger->name, &linger->inflight);
+    }
+    if (linger->fd < 0 || linger->inflight.empty() || checksLeft <= 0)
+    {
+        return; // the last reference, ~ZeroCopyLinger closes the socket
+    }
+    loop->runAfter(kZeroCopyLingerInterval, std::bind(&TcpConnection::lingerZeroCopy, loop, linger, checksLeft - 1));
+}
+
+void TcpConnection::readZeroCopyCompletions(int fd, const std::string &name, ZeroCopyPins *inflight)
+{
+    char control[128];
+    for (;;)
+    {
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            break; // EAGAIN: queue drained
+        }
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            const struct sock_extended_err *serr =
+                reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+            const uint32_t hi = serr->ee_data;
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                // e.g. loopback or a NIC without scatter-gather: the pinning bought nothing
+                LOG_DEBUG("TcpConnection::readZeroCopyCompletions name:%s - kernel copied %u..%u\n",
+                          name.c_str(), serr->ee_info, hi);
+            }
+            while (!inflight->empty() && static_cast<int32_t>(inflight->front().first - hi) <= 0)
+            {
+                inflight->pop_front();
+            }
+        }
+    }
+}
+
 void TcpConnection::handleError()
 {
+    // EPOLLERR is also how the kernel signals zero-copy completions
+    const bool zeroCopy = zeroCopyThreshold_ > 0 || !zeroCopyInflight_.empty();
+    if (zeroCopy)
+    {
+        readZeroCopyCompletions(channel_->fd(), name_, &zeroCopyInflight_);
+    }
+
     int optval;
     socklen_t optlen = sizeof optval;
     int err = 0;
@@ -205,7 +701,10 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
-    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d\n", name_.c_str(), err);
+    if (err != 0 || !zeroCopy)
+    {
+        LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d\n", name_.c_str(), err);
+    }
 }
 
 void TcpConnection::sendInLoop(const void *data, size_t len)
@@ -217,6 +716,7 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     if (state_ == kDisconnected)
     {
         LOG_ERROR("disconnected, give up writing");
+        return;
     }
 
     /**
@@ -228,6 +728,8 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
         nwrote = ::write(channel_->fd(), data, len);
         if (nwrote >= 0)
         {
+            idleNode_.touch();
+            loop_->addBytesWritten(nwrote);
             remaining = len - nwrote;
             if (!remaining && writeCompleteCallback_)
             {
@@ -272,7 +774,9 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
         {
             loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
         }
-        outputBuffer_.append((char *)data + nwrote, remaining);
+        // keep send order: data sent after a queued file goes behind that file
+        SegmentedBuffer &output = pendingFiles_.empty() ? outputBuffer_ : pendingFiles_.back().trailing;
+        output.append((char *)data + nwrote, remaining);
         if (!channel_->isWriting())
         {
             channel_->enableWriting();
@@ -289,6 +793,84 @@ void TcpConnection::shutdownInLoop()
     }
 }
 
-void TcpConnection::sendFileInLoop(int fd, off_t *offset, size_t count)
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t count)
 {
+    size_t remaining = count;
+    bool faultError = false;
+
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up sending file");
+        return;
+    }
+
+    // nothing queued ahead of the file, let the kernel copy as much as the socket accepts
+    if (!(channel_->isWriting() || outputBuffer_.readableBytes() || !pendingFiles_.empty()))
+    {
+        ssize_t nwrote = ::sendfile(channel_->fd(), fd, &offset, count);
+        if (nwrote >= 0)
+        {
+            idleNode_.touch();
+            loop_->addBytesWritten(nwrote);
+            remaining = count - nwrote;
+            if (nwrote == 0 && count > 0)
+            {
+                LOG_ERROR("TcpConnection::sendFileInLoop fd=%d reached EOF early", fd);
+                remaining = 0;
+            }
+            if (!remaining && writeCompleteCallback_)
+            {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+        }
+        else if (errno != EWOULDBLOCK && errno != EINTR)
+        {
+            int savedErrno = errno;
+            LOG_ERROR("TcpConnection::sendFileInLoop name:%s - errno:%d\n", name_.c_str(), savedErrno);
+            // the peer would wait forever for a file that is never sent
+            faultError = true;
+            forceClose();
+        }
+    }
+
+    // the rest is finished by handleWrite once the socket becomes writable
+    if (!faultError && remaining > 0)
+    {
+        pendingFiles_.emplace_back(fd, offset, remaining, loop_->blockPool());
+        if (!channel_->isWriting())
+        {
+            channel_->enableWriting();
+        }
+    }
+}
+
+/**
+ * Continue the file at the front of pendingFiles_, only called when outputBuffer_
+ * is empty. Returns true once the whole region is sent, its trailing data then
+ * becomes the new outputBuffer_.
+ */
+bool TcpConnection::writePendingFile(int *savedErrno)
+{
+    PendingFile &file = pendingFiles_.front();
+    ssize_t n = ::sendfile(channel_->fd(), file.fd, &file.offset, file.remaining);
+    if (n < 0)
+    {
+        *savedErrno = errno;
+        return false;
+    }
+    idleNode_.touch();
+    loop_->addBytesWritten(n);
+    file.remaining -= n;
+    if (n == 0 && file.remaining > 0)
+    {
+        LOG_ERROR("TcpConnection::writePendingFile fd=%d reached EOF early", file.fd);
+        file.remaining = 0;
+    }
+    if (file.remaining > 0)
+    {
+        return false;
+    }
+    outputBuffer_.swap(file.trailing);
+    pendingFiles_.pop_front();
+    return true;
 }
\ No newline at end of file
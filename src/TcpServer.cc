@@ -1,5 +1,8 @@
 #include <functional>
+#include <condition_variable>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include "TcpServer.h"
 #include "Logger.h"
@@ -14,29 +17,87 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
     return loop;
 }
 
+static void establishConnections(const std::vector<TcpConnectionPtr> &conns)
+{
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        conn->connectEstablished();
+    }
+}
+
 TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr,
                      const std::string &nameArg, Option option)
     : loop_(CheckLoopNotNull(loop)),
       ipPort_(listenAddr.toIpPort()),
       name_(nameArg),
-      acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+      listenAddr_(listenAddr),
+      option_(option),
       threadPool_(new EventLoopThreadPool(loop, name_)),
-      connectionCallback_(),
-      messageCallback_(),
+      connectionCallback_(defaultConnectionCallback),
+      messageCallback_(defaultMessageCallback),
       numThreads_(0),
+      edgeTriggered_(false),
+      busyPollMicroSeconds_(0),
+      socketBusyPollMicroSeconds_(0),
+      maxAcceptsPerRead_(Acceptor::kDefaultMaxAcceptsPerRead),
       nextConnId_(1),
       started_(0)
 {
-    acceptor_->setNewConnectionCallback(
-        std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    if (!acceptorPerLoop())
+    {
+        acceptor_.reset(new Acceptor(loop, listenAddr, option == kReusePort));
+        acceptor_->setNewConnectionCallback(
+            std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+        acceptor_->setAcceptBatchCallback(std::bind(&TcpServer::establishPendingConnections, this));
+    }
 }
 
 TcpServer::~TcpServer()
 {
-    for (auto &item : connections_)
+    /**
+     * An Acceptor's channel belongs to its loop, tear it down there. Wait for
+     * it: its callbacks are bound to this, and one could still be running or
+     * be about to run in that loop.
+     */
+    for (std::unique_ptr<Acceptor> &acceptor : loopAcceptors_)
+    {
+        EventLoop *ioLoop = acceptor->getLoop();
+        if (ioLoop->isInLoopThread())
+        {
+            acceptor.reset();
+            continue;
+        }
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool stopped = false;
+        Acceptor *raw = acceptor.release();
+        ioLoop->runInLoop([raw, &mutex, &cond, &stopped]()
+                          {
+                              delete raw;
+                              std::lock_guard<std::mutex> lock(mutex);
+                              stopped = true;
+                              cond.notify_one();
+                          });
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&stopped]()
+                  { return stopped; });
+    }
+    /**
+     * In the per-loop modes IO threads still erase from connections_, take
+     * it under the lock. A connection closing in its loop right now must not
+     * call back into this once it is gone.
+     */
+    ConnectionMap connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections.swap(connections_);
+    }
+    for (auto &item : connections)
     {
         TcpConnectionPtr conn(item.second);
         item.second.reset();
+        conn->getLoop()->runInLoop([conn]()
+                                   { conn->setCloseCallback([](const TcpConnectionPtr &) {}); });
         conn->getLoop()->runInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
     }
 }
@@ -46,20 +107,86 @@ void TcpServer::setThreadNum(int numThreads)
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setMaxAcceptsPerRead(int n)
+{
+    maxAcceptsPerRead_ = n;
+    if (acceptor_)
+    {
+        acceptor_->setMaxAcceptsPerRead(n);
+    }
+}
+
 void TcpServer::start()
 {
     if (started_ ++ == 0)
     {
         threadPool_->start(threadInitCallback_);
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        if (busyPollMicroSeconds_ > 0)
+        {
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                ioLoop->setBusyPoll(busyPollMicroSeconds_);
+            }
+        }
+        for (const EventLoopThreadPool::LoopPlacement &placement : threadPool_->layout())
+        {
+            if (placement.cpu >= 0)
+            {
+                LOG_INFO("TcpServer::start [%s] - loop %s on cpu %d numa node %d\n",
+                         name_.c_str(), placement.name.c_str(), placement.cpu, placement.numaNode);
+            }
+        }
+        if (acceptorPerLoop())
+        {
+            startLoopAcceptors();
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
+    }
+}
+
+void TcpServer::startLoopAcceptors()
+{
+    for (EventLoop *ioLoop : threadPool_->getAllLoops())
+    {
+        Acceptor *acceptor;
+        if (option_ == kSharedListenFd && !loopAcceptors_.empty())
+        {
+            acceptor = new Acceptor(ioLoop, ::dup(loopAcceptors_.front()->fd()));
+        }
+        else
+        {
+            acceptor = new Acceptor(ioLoop, listenAddr_, option_ == kReusePortPerLoop);
+            acceptor->setExclusive(option_ == kSharedListenFd);
+        }
+        acceptor->setMaxAcceptsPerRead(maxAcceptsPerRead_);
+        acceptor->setNewConnectionCallback(
+            std::bind(&TcpServer::newConnectionInLoop, this, ioLoop, std::placeholders::_1, std::placeholders::_2));
+        loopAcceptors_.push_back(std::unique_ptr<Acceptor>(acceptor));
+        ioLoop->runInLoop(std::bind(&Acceptor::listen, acceptor));
     }
 }
 
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 {
-    EventLoop *ioLoop = threadPool_->getNextLoop();
+    newConnectionInLoop(threadPool_->getLoopForPeer(peerAddr), sockfd, peerAddr);
+}
+
+/**
+ * Called in the accepting loop: the base loop, or ioLoop itself when every
+ * IO loop has its own Acceptor.
+ */
+void TcpServer::newConnectionInLoop(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    int connId;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connId = nextConnId_++;
+    }
     char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_++);
+    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), connId);
     std::string connName = name_ + buf;
 
     LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s\n",
@@ -75,27 +202,81 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 
     InetAddress localAddr(local);
     TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
-    connections_[connName] = conn;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_[connName] = conn;
+    }
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    if (socketBusyPollMicroSeconds_ > 0 && !conn->setSocketBusyPoll(socketBusyPollMicroSeconds_))
+    {
+        LOG_ERROR("TcpServer::newConnection [%s] - SO_BUSY_POLL failed:%d\n", name_.c_str(), errno);
+    }
 
     conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    if (ioLoop->isInLoopThread())
+    {
+        conn->connectEstablished();
+    }
+    else
+    {
+        // handed over with the rest of the accept batch
+        pendingConnections_.push_back(conn);
+    }
+}
 
+/**
+ * End of an accept batch in the base loop: one queueInLoop per sub loop
+ * carries all of its new connections, instead of one post (and possibly one
+ * wakeup) per connection.
+ */
+void TcpServer::establishPendingConnections()
+{
+    while (!pendingConnections_.empty())
+    {
+        EventLoop *ioLoop = pendingConnections_.front()->getLoop();
+        std::vector<TcpConnectionPtr> batch;
+        std::vector<TcpConnectionPtr> others;
+        for (TcpConnectionPtr &conn : pendingConnections_)
+        {
+            if (conn->getLoop() == ioLoop)
+            {
+                batch.push_back(std::move(conn));
+            }
+            else
+            {
+                others.push_back(std::move(conn));
+            }
+        }
+        pendingConnections_.swap(others);
+        ioLoop->queueInLoop(std::bind(&establishConnections, std::move(batch)));
+    }
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr &conn)
 {
-    loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    if (acceptorPerLoop())
+    {
+        // the connection never visited the base loop, don't send it there to die
+        removeConnectionInLoop(conn);
+    }
+    else
+    {
+        loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    }
 }
 
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
 {
         LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n",
              name_.c_str(), conn->name().c_str());
-        
-        connections_.erase(conn->name());
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connections_.erase(conn->name());
+        }
         EventLoop *ioLoop = conn->getLoop();
         ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
 }
\ No newline at end of file
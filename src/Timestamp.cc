@@ -1,4 +1,5 @@
 #include <time.h>
+#include <sys/time.h>
 
 #include "Timestamp.h"
 
@@ -14,13 +15,16 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
 
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(NULL));
+    struct timeval tv;
+    ::gettimeofday(&tv, NULL);
+    return Timestamp(static_cast<int64_t>(tv.tv_sec) * kMicroSecondsPerSecond + tv.tv_usec);
 }
 
 std::string Timestamp::toString() const
 {
     char buf[128];
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
+    time_t seconds = secondsSinceEpoch();
+    tm *tm_time = localtime(&seconds);
     snprintf(buf, sizeof(buf), "%4d/%02d/%02d %02d:%02d:%02d",
              tm_time->tm_year + 1900,
              tm_time->tm_mon + 1,
@@ -29,4 +33,4 @@ std::string Timestamp::toString() const
              tm_time->tm_min,
              tm_time->tm_sec);
     return buf;
-}
\ No newline at end of file
+}
@@ -0,0 +1,161 @@
+#include <math.h>
+
+#include "TimingWheel.h"
+#include "EventLoop.h"
+
+TimingWheel::Node::~Node()
+{
+    if (wheel_)
+    {
+        wheel_->remove(this);
+    }
+}
+
+static int64_t roundUpPowerOfTwo(int n)
+{
+    int64_t size = 1;
+    while (size < n)
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+TimingWheel::TimingWheel(EventLoop *loop, double tickSeconds, int numBuckets)
+    : loop_(loop),
+      tickSeconds_(tickSeconds),
+      mask_(roundUpPowerOfTwo(numBuckets) - 1),
+      buckets_(static_cast<size_t>(mask_ + 1), nullptr),
+      currentTick_(0),
+      size_(0),
+      ticking_(false)
+{
+}
+
+TimingWheel::~TimingWheel()
+{
+    if (ticking_)
+    {
+        loop_->cancel(tickTimer_);
+    }
+    for (Node *head : buckets_)
+    {
+        while (head)
+        {
+            Node *node = head;
+            head = node->next_;
+            node->prev_ = node->next_ = nullptr;
+            node->wheel_ = nullptr;
+        }
+    }
+}
+
+void TimingWheel::add(Node *node, double timeout, TimeoutCallback cb)
+{
+    if (node->wheel_)
+    {
+        remove(node);
+    }
+    int64_t ticks = static_cast<int64_t>(::ceil(timeout / tickSeconds_));
+    node->timeoutTicks_ = ticks > 0 ? ticks : 1;
+    node->lastActiveTick_ = currentTick_;
+    node->callback_ = std::move(cb);
+    link(node, currentTick_ + node->timeoutTicks_);
+    ++size_;
+
+    if (!ticking_)
+    {
+        ticking_ = true;
+        tickTimer_ = loop_->runEvery(tickSeconds_, std::bind(&TimingWheel::onTick, this));
+    }
+}
+
+void TimingWheel::remove(Node *node)
+{
+    if (node->wheel_ == this)
+    {
+        unlink(node);
+        node->wheel_ = nullptr;
+        node->callback_ = TimeoutCallback();
+        --size_;
+    }
+}
+
+/**
+ * Advance one tick and walk the bucket it lands on. Nodes touched since they
+ * were linked are moved to the bucket of their new deadline, the rest expire.
+ * Callbacks run after the walk, so they may freely add/remove other nodes.
+ */
+void TimingWheel::onTick()
+{
+    ++currentTick_;
+    Node *&bucket = buckets_[static_cast<size_t>(currentTick_ & mask_)];
+    Node *head = bucket;
+    bucket = nullptr;
+
+    std::vector<TimeoutCallback> expired;
+    while (head)
+    {
+        Node *node = head;
+        head = node->next_;
+        node->prev_ = node->next_ = nullptr;
+
+        int64_t deadline = node->lastActiveTick_ + node->timeoutTicks_;
+        if (node->expireTick_ > currentTick_)
+        {
+            link(node, node->expireTick_); // due on a later revolution
+        }
+        else if (deadline > currentTick_)
+        {
+            link(node, deadline);
+        }
+        else
+        {
+            node->wheel_ = nullptr;
+            --size_;
+            expired.push_back(std::move(node->callback_));
+        }
+    }
+
+    if (size_ == 0)
+    {
+        ticking_ = false;
+        loop_->cancel(tickTimer_);
+    }
+
+    for (const TimeoutCallback &cb : expired)
+    {
+        cb();
+    }
+}
+
+void TimingWheel::link(Node *node, int64_t expireTick)
+{
+    Node *&head = buckets_[static_cast<size_t>(expireTick & mask_)];
+    node->wheel_ = this;
+    node->expireTick_ = expireTick;
+    node->prev_ = nullptr;
+    node->next_ = head;
+    if (head)
+    {
+        head->prev_ = node;
+    }
+    head = node;
+}
+
+void TimingWheel::unlink(Node *node)
+{
+    if (node->prev_)
+    {
+        node->prev_->next_ = node->next_;
+    }
+    else
+    {
+        buckets_[static_cast<size_t>(node->expireTick_ & mask_)] = node->next_;
+    }
+    if (node->next_)
+    {
+        node->next_->prev_ = node->prev_;
+    }
+    node->prev_ = node->next_ = nullptr;
+}
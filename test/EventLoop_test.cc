@@ -0,0 +1,51 @@
+#include <stdio.h>
+
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+
+/**
+ * quit() must not get lost when it comes before loop() starts, e.g. right
+ * after EventLoopThread::startLoop() returns, and a loop that quit can be
+ * run again.
+ */
+
+static bool check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "FAILED: %s\n", what);
+    }
+    return ok;
+}
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+    bool ok = true;
+
+    // startLoop() returns before the thread enters loop(), the destructor's
+    // join hangs (and ctest times out) if that quit() is dropped
+    for (int i = 0; i < 200; ++i)
+    {
+        EventLoopThread thread;
+        EventLoop *loop = thread.startLoop();
+        loop->quit();
+    }
+
+    EventLoop loop;
+    loop.quit();
+    loop.loop(); // returns right away, the earlier quit() counts
+
+    bool fired = false;
+    loop.runAfter(0.01, [&]()
+                  {
+                      fired = true;
+                      loop.quit();
+                  });
+    loop.loop(); // runs again until the timer quits it
+    ok &= check(fired, "loop() runs again after a quit");
+
+    printf("%s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
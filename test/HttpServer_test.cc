@@ -0,0 +1,110 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+
+#include "EventLoop.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpServer.h"
+#include "Logger.h"
+
+/**
+ * A request that arrives after the server shut a connection down must not
+ * leave its response behind for the next connection of the same IO thread.
+ */
+
+static const uint16_t kPort = 19381;
+
+static int connectToServer()
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct timeval timeout = {2, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void sendAll(int fd, const std::string &data)
+{
+    ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+}
+
+// until the server closes its side, or the receive timeout
+static std::string readToEnd(int fd)
+{
+    std::string received;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0)
+    {
+        received.append(buf, n);
+    }
+    return received;
+}
+
+static bool check(bool ok, const char *what, const std::string &response)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "FAILED: %s, response:\n%s\n", what, response.c_str());
+    }
+    return ok;
+}
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+    EventLoop loop;
+    HttpServer server(&loop, InetAddress(kPort), "HttpServer_test");
+    server.setHttpCallback([](const HttpRequest &req, HttpResponse *resp)
+                           {
+                               resp->setStatusCode(HttpResponse::k200Ok);
+                               resp->setStatusMessage("OK");
+                               resp->setBody("path=" + req.path());
+                           });
+    server.start();
+
+    bool ok = true;
+    std::thread client([&]()
+                       {
+                           int first = connectToServer();
+                           sendAll(first, "GET /first HTTP/1.1\r\nConnection: close\r\n\r\n");
+                           std::string response = readToEnd(first);
+                           ok &= check(response.find("path=/first") != std::string::npos, "first response", response);
+
+                           // the server has shut its side down, this one stays unanswered
+                           sendAll(first, "GET /late HTTP/1.1\r\n\r\n");
+                           ::usleep(100 * 1000);
+
+                           int second = connectToServer();
+                           sendAll(second, "GET /second HTTP/1.1\r\nConnection: close\r\n\r\n");
+                           response = readToEnd(second);
+                           ok &= check(response.find("path=/second") != std::string::npos, "second response", response);
+                           ok &= check(response.find("path=/late") == std::string::npos,
+                                       "no leftover from the shut down connection", response);
+
+                           ::close(first);
+                           ::close(second);
+                           loop.quit();
+                       });
+    loop.loop();
+    client.join();
+
+    printf("%s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
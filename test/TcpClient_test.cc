@@ -0,0 +1,209 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "EventLoop.h"
+#include "Logger.h"
+#include "TcpClient.h"
+#include "TcpServer.h"
+#include "Timestamp.h"
+
+/**
+ * Many TcpClients on one loop all get connected to an in-process TcpServer,
+ * a client started before its server gets there through the Connector's
+ * retry, and a socket that connected to itself is never handed out.
+ */
+
+static const uint16_t kPort = 19382;
+static const uint16_t kRetryPort = 19383;
+static const uint16_t kSelfPort = 19384;
+static const int kClients = 2000;
+
+static bool check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "FAILED: %s\n", what);
+    }
+    return ok;
+}
+
+// run the loop until quit() or `seconds`, whichever comes first
+static void runFor(EventLoop *loop, double seconds)
+{
+    TimerId timer = loop->runAfter(seconds, [loop]()
+                                   { loop->quit(); });
+    loop->loop();
+    loop->cancel(timer);
+}
+
+// each client and its server side take a descriptor
+static int maxClients()
+{
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) < 0)
+    {
+        return 400;
+    }
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    int usable = static_cast<int>(std::min<rlim_t>(limit.rlim_cur, 1 << 20)) / 2 - 64;
+    return std::min(kClients, usable);
+}
+
+static double percentile(const std::vector<double> &sorted, double q)
+{
+    size_t i = static_cast<size_t>(q * sorted.size());
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+static bool testManyClients(EventLoop *loop)
+{
+    TcpServer server(loop, InetAddress(kPort), "TcpClient_test");
+    server.start();
+
+    const int count = maxClients();
+    std::vector<std::unique_ptr<TcpClient>> clients;
+    std::vector<Timestamp> started(count);
+    std::vector<double> latencyMs;
+    latencyMs.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        char name[32];
+        snprintf(name, sizeof name, "client%d", i);
+        clients.emplace_back(new TcpClient(loop, InetAddress(kPort), name));
+        clients.back()->setConnectionCallback([&, i](const TcpConnectionPtr &conn)
+                                              {
+                                                  if (conn->connected())
+                                                  {
+                                                      latencyMs.push_back(timeDifference(Timestamp::now(), started[i]) * 1000);
+                                                      if (static_cast<int>(latencyMs.size()) == count)
+                                                      {
+                                                          loop->quit();
+                                                      }
+                                                  }
+                                              });
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        started[i] = Timestamp::now();
+        clients[i]->connect();
+    }
+    runFor(loop, 20.0);
+
+    bool ok = check(static_cast<int>(latencyMs.size()) == count, "every client connects");
+    if (!latencyMs.empty())
+    {
+        std::sort(latencyMs.begin(), latencyMs.end());
+        printf("%zu/%d clients connected, latency p50 %.2f ms p90 %.2f ms p99 %.2f ms max %.2f ms\n",
+               latencyMs.size(), count, percentile(latencyMs, 0.5), percentile(latencyMs, 0.9),
+               percentile(latencyMs, 0.99), latencyMs.back());
+    }
+
+    clients.clear();
+    runFor(loop, 0.1); // the closes the client destructors queued
+    return ok;
+}
+
+static bool testRetry(EventLoop *loop)
+{
+    bool connected = false;
+    TcpClient client(loop, InetAddress(kRetryPort), "retry");
+    client.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+                                     if (conn->connected())
+                                     {
+                                         connected = true;
+                                         loop->quit();
+                                     }
+                                 });
+    client.connect(); // refused, the Connector retries in kInitRetryDelayMs
+    runFor(loop, 0.1);
+    bool ok = check(!connected, "no connection before the server is up");
+
+    TcpServer server(loop, InetAddress(kRetryPort), "retry");
+    server.start();
+    runFor(loop, 3.0);
+    ok &= check(connected, "the retry connects once the server is up");
+
+    client.stop();
+    return ok;
+}
+
+/**
+ * A private network namespace whose only ephemeral port is the one connected
+ * to, so the first attempt is a TCP simultaneous open with itself. Needs
+ * CAP_SYS_ADMIN, returns false to skip the test without it.
+ */
+static bool pinEphemeralPort(uint16_t port)
+{
+    if (::unshare(CLONE_NEWNET) < 0)
+    {
+        return false;
+    }
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct ifreq ifr;
+    ::memset(&ifr, 0, sizeof ifr);
+    ::strncpy(ifr.ifr_name, "lo", IFNAMSIZ - 1);
+    bool up = ::ioctl(fd, SIOCGIFFLAGS, &ifr) == 0;
+    ifr.ifr_flags |= IFF_UP;
+    up = up && ::ioctl(fd, SIOCSIFFLAGS, &ifr) == 0;
+    ::close(fd);
+
+    char range[32];
+    int len = snprintf(range, sizeof range, "%d %d", port, port);
+    fd = ::open("/proc/sys/net/ipv4/ip_local_port_range", O_WRONLY | O_CLOEXEC);
+    bool pinned = fd >= 0 && ::write(fd, range, len) == len;
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    return up && pinned;
+}
+
+static bool testSelfConnect(EventLoop *loop)
+{
+    if (!pinEphemeralPort(kSelfPort))
+    {
+        printf("self connect: skipped, needs CAP_SYS_ADMIN for a network namespace\n");
+        return true;
+    }
+    bool connected = false;
+    TcpClient client(loop, InetAddress(kSelfPort), "self");
+    client.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+                                     if (conn->connected())
+                                     {
+                                         connected = true;
+                                         loop->quit();
+                                     }
+                                 });
+    client.connect();
+    runFor(loop, 0.3);
+    client.stop();
+    return check(!connected, "a self connect is rejected");
+}
+
+int main()
+{
+    Logger::setLogLevel(ERROR);
+    EventLoop loop;
+    bool ok = true;
+    ok &= testManyClients(&loop);
+    ok &= testRetry(&loop);
+    ok &= testSelfConnect(&loop); // last, it moves this thread into another network namespace
+
+    printf("%s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}